@@ -44,6 +44,16 @@ struct BFS_Vertex {
 };
 
 struct BFS_edge_F {
+    int infiniteCost;
+
+    BFS_edge_F(int _inf) : infiniteCost(_inf) {}
+
+    /** Whether a vertex still looks for a parent in a bottom-up step. */
+    __device__
+    inline bool cond(BFS_Vertex dst) {
+        return dst.level == infiniteCost;
+    }
+
     __device__
     inline int gather(BFS_Vertex src, EdgeId outdegree, Dump_Edge edge) {
         return src.level + 1;        
@@ -53,7 +63,7 @@ struct BFS_edge_F {
     inline void reduce(int &accumulator, int accum) {
         accumulator = accum; // benign race happens
     }
-};  // edgeMap
+};  // edgeFilter
 
 struct BFS_vertex_F {
     int infiniteCost;
@@ -80,22 +90,31 @@ struct BFS_init_F {
 
 
 int main(int argc, char **argv) {
-    CommandLine cl(argc, argv, "<inFile> [-dimacs] [-verbose] [-round 100]");
-    char * inFile = cl.getArgument(0);
-    VertexId source = cl.getOptionIntValue("-s", 0);
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-reorder degree|rcm|community] [-compress] [-push] [-verbose] [-round 100]");
+    VertexId source = cl.getOptionLongValue("-s", 0);
     int max_rounds = cl.getOptionIntValue("-round", 100);
-    bool dimacs = cl.getOption("-dimacs");
+    bool compress = cl.getOption("-compress");
+    bool push = cl.getOption("-push");
+    char * order = cl.getOptionValue("-reorder");
     bool verbose = cl.getOption("-verbose");
-    int group_size = cl.getOptionIntValue("-g", 1);
+    if (verbose) Logging::ReportingLevel() = DEBUG1;
     bool use_scan = cl.getOption("-scan");
 
     // Read the graph file.
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
+    if (!graph.fromCommandLine(cl)) return 1;
+    if (order) {
+        VertexOrdering *ordering = VertexOrdering::fromName(order);
+        if (ordering == NULL) {
+            LOG(ERROR) << "Unknown vertex ordering: " << order;
+            return 1;
+        }
+        graph.reorder(*ordering);
+        delete ordering;
     }
+    if (compress) graph.compress();
+    // Bottom-up steps look for parents along the incoming edges.
+    if (!push) graph.buildIncoming();
 
     // Algorithm specific parameters
     const int infCost = 0x7fffffff;
@@ -110,29 +129,25 @@ int main(int argc, char **argv) {
 
     // Make a dense VertexSubset with a singleton vertex (source)
     // and initializes the level of it to 0
-    VertexSubset frontier(graph.vertexCount, source);
+    VertexSubset frontier(graph.vertexCount, graph.toNewId(source));
     ol.vertexMap<BFS_init_F>(frontier, BFS_init_F(0));
 
     // Sparse VertexSubset to represent the expanding edges.
     VertexSubset edgeFrontier(graph.vertexCount, false); 
 
+    // Switches between top-down and bottom-up steps.
+    DirectionOptimizer direction(graph.vertexCount, graph.edgeCount);
+    BFS_edge_F edge_f(infCost);
+
     double start = getTimeMillis();    
     Stopwatch w;
     w.start();
 
     int iterations = 0;
     while (1) {
-        int size = frontier.size();
-        
-        switch(group_size) {
-            case 1:  ol.edgeFilter<BFS_edge_F, 1>(edgeFrontier, frontier, BFS_edge_F()); break;
-            case 2:  ol.edgeFilter<BFS_edge_F, 2>(edgeFrontier, frontier, BFS_edge_F()); break;
-            case 4:  ol.edgeFilter<BFS_edge_F, 4>(edgeFrontier, frontier, BFS_edge_F()); break;
-            case 8:  ol.edgeFilter<BFS_edge_F, 8>(edgeFrontier, frontier, BFS_edge_F()); break;
-            case 16: ol.edgeFilter<BFS_edge_F, 16>(edgeFrontier, frontier, BFS_edge_F()); break;
-            case 32: ol.edgeFilter<BFS_edge_F, 32>(edgeFrontier, frontier, BFS_edge_F()); break;
-            default: assert(0);
-        }
+        VertexId size = frontier.size();
+
+        ol.edgeFilter<BFS_edge_F>(edgeFrontier, frontier, edge_f, direction);
 
         if (use_scan) 
             ol.vertexFilter<BFS_vertex_F, true>(frontier, edgeFrontier, BFS_vertex_F(infCost));
@@ -0,0 +1,250 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Connected Components, by Afforest: union-find hooking with pointer jumping,
+ * where a few sampled neighbors of every vertex find the giant component, so
+ * that the rest of its edges can be skipped.
+ *
+ * The components are weakly connected: an edge joins its endpoints whichever
+ * way it goes. Union-find follows parents at random, which the functors of the
+ * engine can not, so the passes run on the thread pool over the CSR graph.
+ * Hence CC is only built for the host backend (`make CC.host`).
+ */
+
+#include <unordered_map>
+
+#include "oliver.h"
+
+/** Seed of the vertices sampled for the giant component. */
+const unsigned long long SAMPLE_SEED = 27491095ULL;
+
+/**
+ * Reads the out-neighbors of a vertex in place, or decodes them into its own
+ * buffer if the graph is compressed. One per worker.
+ */
+class NeighborReader {
+public:
+    NeighborReader(const CsrGraph<int, int> &_graph) : graph(_graph) {}
+
+    const VertexId *read(VertexId v) {
+        if (graph.edges != NULL) return graph.edges + graph.vertices[v];
+        buffer.resize(graph.vertices[v + 1] - graph.vertices[v]);
+        graph.getNeighbors(v, buffer.data());
+        return buffer.data();
+    }
+
+private:
+    const CsrGraph<int, int> &graph;
+    std::vector<VertexId>     buffer;
+};
+
+/**
+ * Joins the trees of `u` and `v` by hooking the larger of their roots under
+ * the smaller one, so every tree is rooted at its smallest vertex. A root
+ * that another thread hooks first is followed up and tried again.
+ */
+inline void link(VertexId u, VertexId v, VertexId *comp) {
+    VertexId p1 = comp[u];
+    VertexId p2 = comp[v];
+    while (p1 != p2) {
+        VertexId high = std::max(p1, p2);
+        VertexId low = std::min(p1, p2);
+        VertexId pHigh = comp[high];
+        if (pHigh == low) break;
+        if (pHigh == high && util::compareAndSwap(&comp[high], high, low)) break;
+        p1 = comp[comp[high]];
+        p2 = comp[low];
+    }
+}
+
+/** Points every vertex at the root of its tree (pointer jumping). */
+void compressPaths(VertexId *comp, VertexId n) {
+    ThreadPool::get().parallelFor(n, [&](size_t begin, size_t end, int) {
+        for (VertexId v = begin; v < end; v++) {
+            while (comp[v] != comp[comp[v]]) {
+                comp[v] = comp[comp[v]];
+            }
+        }
+    });
+}
+
+/**
+ * Returns the most frequent root among `samples` random vertices, which is
+ * the giant component if there is one, and sets `share` to its share.
+ */
+VertexId sampleFrequentRoot(const VertexId *comp, VertexId n, int samples,
+                            double &share) {
+    assert(samples > 0);
+    std::unordered_map<VertexId, int> counts;
+    generator::Random random(SAMPLE_SEED, 0);
+    for (int i = 0; i < samples; i++) {
+        counts[comp[random.nextBelow(n)]]++;
+    }
+    auto most = std::max_element(counts.begin(), counts.end(),
+        [](const std::pair<const VertexId, int> &a,
+           const std::pair<const VertexId, int> &b) { return a.second < b.second; });
+    share = static_cast<double>(most->second) / samples;
+    return most->first;
+}
+
+/**
+ * Labels every vertex with the root of its component, and returns the number
+ * of edges linked.
+ *
+ * The first `neighborRounds` passes link every vertex to one more of its
+ * out-neighbors, and compress the trees. By then a giant component has
+ * usually formed, and the last pass skips its vertices: only the others link
+ * the rest of their out-edges, and their in-edges unless the graph is
+ * `symmetric`, since a vertex of the giant component may point at them.
+ */
+EdgeId afforest(const CsrGraph<int, int> &graph, VertexId *comp, int neighborRounds,
+                int samples, bool symmetric, bool verbose) {
+    VertexId n = graph.vertexCount;
+    ThreadPool &pool = ThreadPool::get();
+    std::vector<EdgeId> linked(pool.size(), 0);
+
+    pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+        for (VertexId v = begin; v < end; v++) comp[v] = v;
+    });
+
+    for (int r = 0; r < neighborRounds; r++) {
+        double start = getTimeMillis();
+        pool.parallelFor(n, [&](size_t begin, size_t end, int wid) {
+            NeighborReader reader(graph);
+            for (VertexId v = begin; v < end; v++) {
+                EdgeId degree = graph.vertices[v + 1] - graph.vertices[v];
+                if (static_cast<EdgeId>(r) >= degree) continue;
+                link(v, reader.read(v)[r], comp);
+                linked[wid]++;
+            }
+        });
+        compressPaths(comp, n);
+        if (verbose) {
+            LOG(INFO) << "CC neighbor round " << r << ", time: "
+                      << getTimeMillis() - start << "ms";
+        }
+    }
+
+    if (n == 0) return 0;
+    double share;
+    VertexId giant = sampleFrequentRoot(comp, n, samples, share);
+    if (verbose) {
+        LOG(INFO) << "CC giant component root: " << giant << ", sampled share: "
+                  << share;
+    }
+
+    double start = getTimeMillis();
+    pool.parallelFor(n, [&](size_t begin, size_t end, int wid) {
+        NeighborReader reader(graph);
+        for (VertexId v = begin; v < end; v++) {
+            if (comp[v] == giant) continue;
+            EdgeId degree = graph.vertices[v + 1] - graph.vertices[v];
+            if (degree > static_cast<EdgeId>(neighborRounds)) {
+                const VertexId *neighbors = reader.read(v);
+                for (EdgeId i = neighborRounds; i < degree; i++) {
+                    link(v, neighbors[i], comp);
+                }
+                linked[wid] += degree - neighborRounds;
+            }
+            if (symmetric) continue;
+            for (EdgeId e = graph.inVertices[v]; e < graph.inVertices[v + 1]; e++) {
+                link(v, graph.inEdges[e], comp);
+            }
+            linked[wid] += graph.inVertices[v + 1] - graph.inVertices[v];
+        }
+    });
+    compressPaths(comp, n);
+    if (verbose) {
+        LOG(INFO) << "CC final round, time: " << getTimeMillis() - start << "ms";
+    }
+
+    EdgeId total = 0;
+    for (size_t w = 0; w < linked.size(); w++) total += linked[w];
+    return total;
+}
+
+int main(int argc, char **argv) {
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-reorder degree|rcm|community] [-compress] [-symmetric] [-neighbors 2] [-samples 1024] [-verbose]");
+    bool compress = cl.getOption("-compress");
+    bool symmetric = cl.getOption("-symmetric");
+    int neighborRounds = cl.getOptionIntValue("-neighbors", 2);
+    int samples = cl.getOptionIntValue("-samples", 1024);
+    char * order = cl.getOptionValue("-reorder");
+    bool verbose = cl.getOption("-verbose");
+    if (neighborRounds < 0 || samples <= 0) {
+        LOG(ERROR) << "-neighbors must not be negative, and -samples must be positive";
+        return 1;
+    }
+
+    // Read the graph file.
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+    if (order) {
+        VertexOrdering *ordering = VertexOrdering::fromName(order);
+        if (ordering == NULL) {
+            LOG(ERROR) << "Unknown vertex ordering: " << order;
+            return 1;
+        }
+        graph.reorder(*ordering);
+        delete ordering;
+    }
+    if (compress) graph.compress();
+    // Vertices outside the giant component look through their in-edges too.
+    if (!symmetric) graph.buildIncoming();
+
+    VertexId n = graph.vertexCount;
+    std::vector<VertexId> comp(n);
+
+    double start = getTimeMillis();
+    EdgeId linked = afforest(graph, comp.data(), neighborRounds, samples,
+                             symmetric, verbose);
+    double totalTime = getTimeMillis() - start;
+
+    // Each component is labeled by its smallest input id.
+    std::vector<VertexId> label(n, static_cast<VertexId>(-1));
+    std::vector<VertexId> size(n, 0);
+    VertexId components = 0;
+    VertexId largest = 0;
+    for (VertexId u = 0; u < n; u++) {
+        VertexId root = comp[graph.toNewId(u)];
+        if (label[root] == static_cast<VertexId>(-1)) {
+            label[root] = u;
+            components++;
+        }
+        largest = std::max(largest, ++size[root]);
+    }
+    LOG(INFO) << "components: " << components << ", largest: " << largest
+              << ", time: " << totalTime << "ms, edges: " << linked;
+
+    // Log the labels into a file
+    FILE * outputFile = fopen("CC.txt", "w");
+    for (VertexId u = 0; u < n; u++) {
+        fprintf(outputFile, "%llu\n",
+                (unsigned long long) label[comp[graph.toNewId(u)]]);
+    }
+    fclose(outputFile);
+    return 0;
+}
@@ -38,14 +38,11 @@ FILE * outputFile;
 struct PR_Vertex {
     double rank;
     double delta;
+    double residual;  // PageRank-Delta: the rank received but not applied yet
 
     void print() {
         fprintf(outputFile, "%f\n", rank);
     }
-
-    void reduce(double &r) {
-        r += fabs(delta);
-    }
 };
 
 struct PR_edge_F {
@@ -58,7 +55,12 @@ struct PR_edge_F {
     inline void reduce(double &accumulator, double accum) {
         atomicAdd(&accumulator, accum);
     }
-};  // edgeMa
+
+    __device__
+    inline void combine(double &accumulator, double accum) {
+        accumulator += accum;
+    }
+};  // edgeMap
 
 struct PR_vertex_F {
     double damping, addConstant;
@@ -74,6 +76,19 @@ struct PR_vertex_F {
     }
 };  // vertexMap
 
+/** Sums up the changes of the ranks. */
+struct PR_error_F {
+    __device__
+    inline double map(PR_Vertex v) {
+        return fabs(v.delta);
+    }
+
+    __device__
+    inline void combine(double &sum, double x) {
+        sum += x;
+    }
+};  // vertexReduce
+
 struct PR_init_F {
     double rank;
 
@@ -83,30 +98,121 @@ struct PR_init_F {
     inline void operator() (PR_Vertex &v, double accum) {
         v.rank = rank;
         v.delta = rank;
+        v.residual = 0;
     }
 };  // vertexMap
 
+/** Pushes the change of the rank, instead of the rank itself. */
+struct PR_delta_edge_F {
+    __device__
+    inline double gather(PR_Vertex srcValue, EdgeId outdegree, Dump_Edge edge) {
+        return srcValue.delta / outdegree;
+    }
+
+    __device__
+    inline void reduce(double &accumulator, double accum) {
+        atomicAdd(&accumulator, accum);
+    }
+};  // edgeFilter
+
+/**
+ * The residual of the first step, i.e. the change from the initial rank to
+ * the one of the first sweep.
+ */
+struct PR_first_F {
+    double damping, addConstant;
+
+    PR_first_F(double _damping, double _oneOverN) : damping(_damping),
+        addConstant( (1-_damping) * _oneOverN ) {}
+
+    __device__
+    inline void operator() (PR_Vertex &v, double accum) {
+        v.residual = damping * accum + addConstant - v.rank;
+    }
+};  // vertexMap
+
+/** Adds the damped changes of the in-neighbors to the residual. */
+struct PR_receive_F {
+    double damping;
+
+    PR_receive_F(double _damping) : damping(_damping) {}
+
+    __device__
+    inline void operator() (PR_Vertex &v, double accum) {
+        v.residual += damping * accum;
+    }
+};  // vertexMap
+
+/**
+ * Applies the residual of the vertices where it exceeds `threshold`, which
+ * push it at the next step.
+ */
+struct PR_apply_F {
+    double threshold;
+
+    PR_apply_F(double _threshold) : threshold(_threshold) {}
+
+    __device__
+    inline bool cond(PR_Vertex v, double accum) {
+        return fabs(v.residual) > threshold;
+    }
+
+    __device__
+    inline void update(PR_Vertex &v, double accum) {
+        v.delta = v.residual;
+        v.rank += v.residual;
+        v.residual = 0;
+    }
+};  // vertexFilter
+
+/** Selects every vertex. */
+struct PR_all_F {
+    __device__
+    inline bool cond(PR_Vertex v, double accum) {
+        return true;
+    }
+
+    __device__
+    inline void update(PR_Vertex &v, double accum) {}
+};  // vertexFilter
+
 int main(int argc, char **argv) {
-    CommandLine cl(argc, argv, "<inFile> [-dimacs] [-verbose] [-round 100]");
-    char * inFile = cl.getArgument(0);
-    bool dimacs = cl.getOption("-dimacs");
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-reorder degree|rcm|community] [-compress] [-push] [-delta] [-threshold <t>] [-verbose] [-round 100]");
+    bool compress = cl.getOption("-compress");
+    char * order = cl.getOptionValue("-reorder");
+    bool push = cl.getOption("-push");
+    bool delta = cl.getOption("-delta");
     bool verbose = cl.getOption("-verbose");
     int max_rounds = cl.getOptionIntValue("-round", 100);
 
 
     // Read the graph file.
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
+    if (!graph.fromCommandLine(cl)) return 1;
+    if (order) {
+        VertexOrdering *ordering = VertexOrdering::fromName(order);
+        if (ordering == NULL) {
+            LOG(ERROR) << "Unknown vertex ordering: " << order;
+            return 1;
+        }
+        graph.reorder(*ordering);
+        delete ordering;
     }
+    if (compress) graph.compress();
+
+    // Pulling over the incoming edges sums up the ranks without atomics.
+    // PageRank-Delta pushes from its frontier only.
+    if (!push && !delta) graph.buildIncoming();
 
     // Algorithm specific parameters
     const double damping = 0.85;
     const double oneOverN = 1.0 / graph.vertexCount;
     const double epsilon = 0.0000001;
 
+    // PageRank-Delta leaves less than `epsilon` unapplied in all by default.
+    const double threshold = cl.getOptionDoubleValue("-threshold",
+                                                     epsilon / graph.vertexCount);
+
     Oliver<PR_Vertex, Dump_Edge, double> ol;
     ol.readGraph(graph);
 
@@ -118,22 +224,58 @@ int main(int argc, char **argv) {
     Stopwatch w;
     w.start();
 
+    // The edges gathered from, in all the steps.
+    EdgeId edges = 0;
     int iterations = 0;
-    while (1) {
-        ol.edgeMap<PR_edge_F>(all, PR_edge_F());
-        ol.vertexMap<PR_vertex_F>(all, PR_vertex_F(damping, oneOverN));
+    if (delta) {
+        // PageRank-Delta. The first step is a full sweep, which every
+        // vertex takes the change of as its residual. From then on a vertex
+        // pushes only the change of its rank, once its unapplied residual
+        // exceeds the threshold, so the frontier shrinks as the ranks
+        // converge.
+        VertexSubset frontier(graph.vertexCount);
+        VertexSubset edgeFrontier(graph.vertexCount, false);
+        ol.vertexFilter<PR_all_F, true>(frontier, all, PR_all_F());
+        while (1) {
+            edges += ol.frontierEdges(frontier);
+            ol.edgeFilter<PR_delta_edge_F>(edgeFrontier, frontier, PR_delta_edge_F());
+            if (iterations == 0) {
+                ol.vertexMap<PR_first_F>(all, PR_first_F(damping, oneOverN));
+                ol.vertexFilter<PR_apply_F, true>(frontier, all, PR_apply_F(threshold));
+            } else {
+                ol.vertexMap<PR_receive_F>(edgeFrontier, PR_receive_F(damping));
+                ol.vertexFilter<PR_apply_F, false>(frontier, edgeFrontier, PR_apply_F(threshold));
+            }
+            double err = ol.vertexReduce<PR_error_F>(frontier, PR_error_F(), 0.0);
+            if (err < epsilon || iterations == max_rounds) break;
+            if (verbose)
+                LOG(INFO) << "PR iterations: " << iterations << ", err: " << err
+                          << ", frontier: " << frontier.size()
+                          << ", time: " << w.getElapsedMillis() << "ms";
 
-        double err = ol.vertexReduce();
-        if (err < epsilon || iterations == max_rounds) break;
-        if (verbose)
-            LOG(INFO) << "PR iterations: " << iterations << ", err: " << err
-                      <<", time: " << w.getElapsedMillis() << "ms";
+            iterations++;
+        }
+        frontier.del();
+        edgeFrontier.del();
+    } else {
+        while (1) {
+            // Pulls, updates and sums up the changes in one sweep, or pushes
+            // without the incoming edges.
+            double err = ol.superstep<PR_edge_F, PR_vertex_F, PR_error_F>(all,
+                PR_edge_F(), PR_vertex_F(damping, oneOverN), PR_error_F(), 0.0);
+            edges += graph.edgeCount;
+            if (err < epsilon || iterations == max_rounds) break;
+            if (verbose)
+                LOG(INFO) << "PR iterations: " << iterations << ", err: " << err
+                          <<", time: " << w.getElapsedMillis() << "ms";
 
-        iterations++;
+            iterations++;
+        }
     }
 
     double totalTime =  getTimeMillis() - start;
-    LOG(INFO) << "iterations: " << iterations <<", time: " << totalTime << "ms";
+    LOG(INFO) << "iterations: " << iterations <<", time: " << totalTime << "ms"
+              << ", edges: " << edges;
 
     // Log the vertex value into a file
     outputFile = fopen("PageRank.txt", "w");
@@ -37,24 +37,18 @@ FILE * outputFile;
 
 struct SSSP_Vertex {
     int distance;
+    int expanded;  // Delta-stepping: the distance it was last expanded at
+    int inFar;     // Delta-stepping: whether it waits in the far pile
 
     inline void print() {
         fprintf(outputFile, "%d\n", distance);
     }
 };
 
-struct SSSP_Edge {
-    int weight;
-
-    inline void print() {
-        fprintf(outputFile, "%d\n", weight);
-    }
-};
-
 struct SSSP_edge_F {
     __device__
-    inline int gather(SSSP_Vertex src, EdgeId outdegree, SSSP_Edge edge) {
-        return src.distance + edge.weight;        
+    inline int gather(SSSP_Vertex src, EdgeId outdegree, int weight) {
+        return src.distance + weight;
     }
 
     __device__
@@ -83,56 +77,234 @@ struct SSSP_vertex_F_init {
     __device__
     inline void operator() (SSSP_Vertex &v, int accum) {
         v.distance = distance;
+        v.expanded = 0x7fffffff;
+        v.inFar = 0;
     }
 };  // vertexMap
 
+/** Selects the vertices closer than `split`, or the others with `!near`. */
+struct SSSP_split_F {
+    int  split;
+    bool near;
+
+    SSSP_split_F(int _split, bool _near) : split(_split), near(_near) {}
+
+    __device__
+    inline bool cond(SSSP_Vertex v, int accum) {
+        return (v.distance < split) == near;
+    }
+
+    __device__
+    inline void update(SSSP_Vertex &v, int accum) {}
+};  // vertexFilter
+
+/** Takes the vertices closer than `split` out of the far pile. */
+struct SSSP_take_F {
+    int split;
+
+    SSSP_take_F(int _split) : split(_split) {}
+
+    __device__
+    inline bool cond(SSSP_Vertex v, int accum) {
+        return v.distance < split;
+    }
+
+    __device__
+    inline void update(SSSP_Vertex &v, int accum) {
+        v.inFar = 0;
+    }
+};  // vertexFilter
+
+/** Puts the vertices at `split` or farther into the far pile, once. */
+struct SSSP_far_F {
+    int split;
+
+    SSSP_far_F(int _split) : split(_split) {}
+
+    __device__
+    inline bool cond(SSSP_Vertex v, int accum) {
+        return v.distance >= split && !v.inFar;
+    }
+
+    __device__
+    inline void update(SSSP_Vertex &v, int accum) {
+        v.inFar = 1;
+    }
+};  // vertexFilter
+
+/**
+ * Selects the vertices not expanded at their distance yet, or with `first`
+ * those never expanded at all.
+ */
+struct SSSP_fresh_F {
+    bool first;
+
+    SSSP_fresh_F(bool _first) : first(_first) {}
 
-struct SSSP_edge_F_init {
-    int weight;
+    __device__
+    inline bool cond(SSSP_Vertex v, int accum) {
+        return first ? v.expanded == 0x7fffffff : v.distance != v.expanded;
+    }
 
-    SSSP_edge_F_init(int _w) : weight(_w) {}
+    __device__
+    inline void update(SSSP_Vertex &v, int accum) {}
+};  // vertexFilter
 
+struct SSSP_expand_F {
     __device__
-    inline int gather(SSSP_Vertex src, EdgeId outdegree, SSSP_Edge &edge) {
-        edge.weight = weight;
-        return 0;       
+    inline void operator() (SSSP_Vertex &v, int accum) {
+        v.expanded = v.distance;
     }
+};  // vertexMap
 
+struct SSSP_min_F {
     __device__
-    inline void reduce(int &accumulator, int accum) {}
-};  // edgeMap to set the edge value
+    inline int map(SSSP_Vertex v) {
+        return v.distance;
+    }
+
+    __device__
+    inline void combine(int &min, int x) {
+        if (x < min) min = x;
+    }
+};  // vertexReduce
+
+/**
+ * Delta-stepping. The vertices are processed in buckets of `delta` distance
+ * units, nearest first. Within the current bucket, the frontier relaxes its
+ * light edges until no vertex of the bucket improves any more; its heavy
+ * edges, which cannot reach back into the bucket, are relaxed once after
+ * that by every vertex the bucket has expanded. The rows are sorted by
+ * weight and split after their light edges, so that each pass only scans
+ * the edges it relaxes.
+ *
+ * Improved vertices beyond the bucket wait in a far pile, which is split
+ * again once the bucket is done: the next bucket is the one of the nearest
+ * waiting vertex. A vertex waits in the pile at most once, and leaves it
+ * without being expanded if it has been expanded at its distance since.
+ *
+ * Returns the number of buckets, and adds the relaxed edges to `relaxations`.
+ */
+int deltaStepping(Oliver<SSSP_Vertex, int, int> &ol, VertexSubset &frontier,
+                  int delta, bool hasHeavy, EdgeId &relaxations) {
+    const int infDistance = 0x7fffffff;
+    VertexId n = frontier.capacity();
+    VertexSubset edgeFrontier(n, false);
+    VertexSubset improved(n);
+    VertexSubset far(n);
+    VertexSubset farNext(n);
+    VertexSubset settled(n);
+    VertexSubset scratch(n);
+
+    int buckets = 0;
+    long long split = delta;
+    while (true) {
+        buckets++;
+        settled.clearAsQueue();
+        while (frontier.size() > 0) {
+            relaxations += ol.frontierEdges(frontier, BEFORE_SPLIT);
+            ol.vertexFilter<SSSP_fresh_F, false>(scratch, frontier, SSSP_fresh_F(true));
+            settled.append(scratch);
+            ol.vertexMap<SSSP_expand_F>(frontier, SSSP_expand_F());
+
+            ol.edgeFilter<SSSP_edge_F>(edgeFrontier, frontier, SSSP_edge_F(), BEFORE_SPLIT);
+            ol.vertexFilter<SSSP_vertex_F, false>(improved, edgeFrontier, SSSP_vertex_F());
+            ol.vertexFilter<SSSP_split_F, false>(frontier, improved, SSSP_split_F(split, true));
+            ol.vertexFilter<SSSP_far_F, false>(scratch, improved, SSSP_far_F(split));
+            far.append(scratch);
+        }
+
+        if (hasHeavy && settled.size() > 0) {
+            relaxations += ol.frontierEdges(settled, FROM_SPLIT);
+            ol.edgeFilter<SSSP_edge_F>(edgeFrontier, settled, SSSP_edge_F(), FROM_SPLIT);
+            ol.vertexFilter<SSSP_vertex_F, false>(improved, edgeFrontier, SSSP_vertex_F());
+            ol.vertexFilter<SSSP_far_F, false>(scratch, improved, SSSP_far_F(split));
+            far.append(scratch);
+        }
+
+        if (far.size() == 0) break;
+
+        // Skips the empty buckets up to the nearest waiting vertex.
+        int nearest = ol.vertexReduce(far, SSSP_min_F(), infDistance);
+        split = std::min<long long>((nearest / delta + 1) * (long long) delta, infDistance);
+        ol.vertexFilter<SSSP_split_F, false>(farNext, far, SSSP_split_F(split, false));
+        ol.vertexFilter<SSSP_take_F, false>(scratch, far, SSSP_take_F(split));
+        ol.vertexFilter<SSSP_fresh_F, false>(frontier, scratch, SSSP_fresh_F(false));
+        std::swap(far, farNext);
+    }
+
+    edgeFrontier.del();
+    improved.del();
+    far.del();
+    farNext.del();
+    settled.del();
+    scratch.del();
+    return buckets;
+}
+
 
 
 int main(int argc, char **argv) {
-    CommandLine cl(argc, argv, "<inFile> [-s 0] [-dimacs] [-verbose]");
-    char * inFile = cl.getArgument(0);
-    VertexId source = cl.getOptionIntValue("-s", 0);
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-maxweight 1] [-s 0] [-dimacs|-binary] [-reorder degree|rcm|community] [-compress] [-delta <d>] [-verbose]");
+    VertexId source = cl.getOptionLongValue("-s", 0);
     int max_rounds = cl.getOptionIntValue("-round", 100);
-    bool dimacs = cl.getOption("-dimacs");
+    bool compress = cl.getOption("-compress");
+    char * order = cl.getOptionValue("-reorder");
+    int delta = cl.getOptionIntValue("-delta", 0);
     bool verbose = cl.getOption("-verbose");
+    if (verbose) Logging::ReportingLevel() = DEBUG1;
 
     // Read the graph file.
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
+    if (!graph.fromCommandLine(cl)) return 1;
+    if (order) {
+        VertexOrdering *ordering = VertexOrdering::fromName(order);
+        if (ordering == NULL) {
+            LOG(ERROR) << "Unknown vertex ordering: " << order;
+            return 1;
+        }
+        graph.reorder(*ordering);
+        delete ordering;
+    }
+    if (delta > 0 && compress) {
+        LOG(ERROR) << "-delta sorts the rows by weight, which -compress can not keep.";
+        return 1;
+    }
+    if (compress) graph.compress();
+
+    // Delta-stepping scans the light and the heavy out-edges of a vertex
+    // apart: its row is sorted by weight, and split after the light ones.
+    std::vector<EdgeId> lightEnds(delta > 0 ? graph.vertexCount : 0);
+    bool hasHeavy = false;
+    if (delta > 0) {
+        graph.sortRowsByValue();
+        for (VertexId v = 0; v < graph.vertexCount; v++) {
+            const int *first = graph.edgeValues + graph.vertices[v];
+            const int *last = graph.edgeValues + graph.vertices[v + 1];
+            if (first != last && *first < 0) {
+                LOG(ERROR) << "Delta-stepping needs non-negative weights.";
+                return 1;
+            }
+            lightEnds[v] = std::upper_bound(first, last, delta) - graph.edgeValues;
+            hasHeavy |= lightEnds[v] != graph.vertices[v + 1];
+        }
     }
 
     // Algorithm specific parameters
     const int infDistance = 0x7fffffff;
 
-    Oliver<SSSP_Vertex, SSSP_Edge, int> ol(infDistance);
+    // The edge weights are loaded along with the graph (1 if unweighted).
+    Oliver<SSSP_Vertex, int, int> ol(infDistance);
     ol.readGraph(graph);
+    if (delta > 0) ol.readRowSplits(lightEnds.data());
 
-    // Initializes the value of all vertices and all edges with universal set.
+    // Initializes the value of all vertices with universal set.
     VertexSubset all(graph.vertexCount, true);
     ol.vertexMap<SSSP_vertex_F_init>(all, SSSP_vertex_F_init(infDistance));
-    ol.edgeMap<SSSP_edge_F_init>(all, SSSP_edge_F_init(1));
     all.del();  // no longer used
 
     // Dense VertexSubset with a singleton vertex.
-    VertexSubset frontier(graph.vertexCount, source); 
+    VertexSubset frontier(graph.vertexCount, graph.toNewId(source)); 
     ol.vertexMap<SSSP_vertex_F_init>(frontier, SSSP_vertex_F_init(0));
 
     // Sparse VertexSubset to represent the expanding edges.
@@ -142,28 +314,35 @@ int main(int argc, char **argv) {
     Stopwatch w;
     w.start();
 
+    // The relaxations are the edges scanned, which the engine sums up.
+    EdgeId relaxations = 0;
     int iterations = 0;
-    while (1) {
-        int size = frontier.size();
-        ol.edgeFilter<SSSP_edge_F>(edgeFrontier, frontier, SSSP_edge_F());
-        ol.vertexFilter<SSSP_vertex_F>(frontier, edgeFrontier, SSSP_vertex_F());
-
-        if (size == 0 || iterations == max_rounds) break;
-
-        // Detect the negative cycle
-        if (iterations == graph.vertexCount) {
-            LOG(INFO) << "negative cycle!";
-            break;
+    if (delta > 0) {
+        iterations = deltaStepping(ol, frontier, delta, hasHeavy, relaxations);
+    } else {
+        while (1) {
+            VertexId size = frontier.size();
+            relaxations += ol.frontierEdges(frontier);
+            ol.edgeFilter<SSSP_edge_F>(edgeFrontier, frontier, SSSP_edge_F());
+            ol.vertexFilter<SSSP_vertex_F, false>(frontier, edgeFrontier, SSSP_vertex_F());
+
+            if (size == 0 || iterations == max_rounds) break;
+
+            // Detect the negative cycle
+            if (iterations == graph.vertexCount) {
+                LOG(INFO) << "negative cycle!";
+                break;
+            }
+            if (verbose)
+                LOG(INFO) << "SSSP iterations: " << iterations <<", size: " << size
+                          << ", time: " << w.getElapsedMillis() << "ms";
+            iterations++;
         }
-        if (verbose)
-            LOG(INFO) << "SSSP iterations: " << iterations <<", size: " << size
-                      << ", time: " << w.getElapsedMillis() << "ms";
-        iterations++;
-
     }
 
     double totalTime =  getTimeMillis() - start;
-    LOG(INFO) << "iterations: "<< iterations <<", time: " << totalTime << "ms";
+    LOG(INFO) << (delta > 0 ? "buckets: " : "iterations: ") << iterations
+              << ", time: " << totalTime << "ms, relaxations: " << relaxations;
     
     // Log the vertex value into a file
     outputFile = fopen("SSSP.txt", "w");
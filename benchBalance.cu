@@ -0,0 +1,159 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Compares the expansion of every fixed `GroupSize` with the load-balanced
+ * and the adaptive ones: the time and TEPS of a top-down BFS with each of
+ * them. The levels are checked to be the same.
+ */
+
+#include "oliver.h"
+
+struct BFS_Vertex {
+    int level;
+};
+
+struct BFS_edge_F {
+    __device__
+    inline int gather(BFS_Vertex src, EdgeId outdegree, Dump_Edge edge) {
+        return src.level + 1;
+    }
+
+    __device__
+    inline void reduce(int &accumulator, int accum) {
+        accumulator = accum; // benign race happens
+    }
+};  // edgeFilter
+
+struct BFS_vertex_F {
+    __device__
+    inline bool cond(BFS_Vertex v, int accum) {
+        return v.level == 0x7fffffff;
+    }
+
+    __device__
+    inline void update(BFS_Vertex &v, int accum) {
+        v.level = accum;
+    }
+};  // vertexFilter
+
+struct BFS_init_F {
+    int level;
+
+    BFS_init_F(int _level) : level(_level) {}
+
+    __device__
+    inline void operator() (BFS_Vertex &v, int accum) {
+        v.level = level;
+    }
+};  // vertexMap
+
+/** Timings of one expansion mode. */
+struct BenchResult {
+    double           millis;
+    EdgeId           edges;
+    std::vector<int> levels;
+};
+
+template<int GroupSize>
+BenchResult runBench(const CsrGraph<int, int> &graph, VertexId source, int rounds) {
+    BenchResult result;
+    result.millis = 0;
+    result.edges = 0;
+    for (int r = 0; r < rounds; r++) {
+        Oliver<BFS_Vertex, Dump_Edge, int> ol;
+        ol.readGraph(graph);
+        VertexId n = graph.vertexCount;
+
+        VertexSubset all(n, true);
+        ol.vertexMap<BFS_init_F>(all, BFS_init_F(0x7fffffff));
+        VertexSubset frontier(n, source);
+        ol.vertexMap<BFS_init_F>(frontier, BFS_init_F(0));
+        VertexSubset edgeFrontier(n, false);
+
+        double start = getTimeMillis();
+        while (frontier.size() > 0) {
+            if (r == 0) result.edges += ol.frontierEdges(frontier);
+            ol.edgeFilter<BFS_edge_F, GroupSize>(edgeFrontier, frontier, BFS_edge_F());
+            ol.vertexFilter<BFS_vertex_F, true>(frontier, edgeFrontier, BFS_vertex_F());
+        }
+        result.millis += getTimeMillis() - start;
+
+        if (r == 0) {
+            const BFS_Vertex *values = ol.getVertexValues();
+            for (VertexId v = 0; v < n; v++) result.levels.push_back(values[v].level);
+        }
+        all.del();
+        frontier.del();
+        edgeFrontier.del();
+    }
+    result.millis /= rounds;
+    return result;
+}
+
+void report(const char *mode, const BenchResult &r) {
+    printf("%-14s BFS %9.2f ms %8.2f MTEPS\n",
+           mode, r.millis, r.edges / r.millis / 1000);
+}
+
+int main(int argc, char **argv) {
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-compress] [-s <hub>] [-round 3]");
+    bool compress = cl.getOption("-compress");
+    int rounds = cl.getOptionIntValue("-round", 3);
+
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+    if (compress) graph.compress();
+
+    // Starts from the vertex of the highest degree by default.
+    VertexId hub = 0;
+    for (VertexId v = 0; v < graph.vertexCount; v++) {
+        if (graph.vertices[v + 1] - graph.vertices[v] >
+            graph.vertices[hub + 1] - graph.vertices[hub]) hub = v;
+    }
+    VertexId source = cl.getOptionLongValue("-s", hub);
+
+    std::vector<BenchResult> results;
+    results.push_back(runBench<1>(graph, source, rounds));
+    results.push_back(runBench<2>(graph, source, rounds));
+    results.push_back(runBench<4>(graph, source, rounds));
+    results.push_back(runBench<8>(graph, source, rounds));
+    results.push_back(runBench<16>(graph, source, rounds));
+    results.push_back(runBench<32>(graph, source, rounds));
+    results.push_back(runBench<LOAD_BALANCED>(graph, source, rounds));
+    results.push_back(runBench<ADAPTIVE>(graph, source, rounds));
+
+    const char *modes[] = {"GroupSize=1", "GroupSize=2", "GroupSize=4", "GroupSize=8",
+                           "GroupSize=16", "GroupSize=32", "load-balanced",
+                           "adaptive"};
+    for (size_t i = 0; i < results.size(); i++) {
+        report(modes[i], results[i]);
+        if (results[i].levels != results[0].levels) {
+            LOG(ERROR) << modes[i] << " disagrees with " << modes[0];
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Compares the plain and the gap-encoded adjacency: the size of the edges,
+ * and the time and TEPS of a BFS (edgeFilter) and of PageRank sweeps
+ * (edgeMap) over each of them. The results of both layouts are checked to
+ * be the same.
+ */
+
+#include "oliver.h"
+
+/** Both algorithms share the engine, and thus the `double` accumulators. */
+struct Bench_Vertex {
+    int    level;
+    double rank;
+};
+
+struct BFS_edge_F {
+    __device__
+    inline double gather(Bench_Vertex src, EdgeId outdegree, Dump_Edge edge) {
+        return src.level + 1;
+    }
+
+    __device__
+    inline void reduce(double &accumulator, double accum) {
+        accumulator = accum; // benign race happens
+    }
+};  // edgeFilter
+
+struct BFS_vertex_F {
+    __device__
+    inline bool cond(Bench_Vertex v, double accum) {
+        return v.level == 0x7fffffff;
+    }
+
+    __device__
+    inline void update(Bench_Vertex &v, double accum) {
+        v.level = static_cast<int>(accum);
+    }
+};  // vertexFilter
+
+struct PR_edge_F {
+    __device__
+    inline double gather(Bench_Vertex srcValue, EdgeId outdegree, Dump_Edge edge) {
+        return srcValue.rank / outdegree;
+    }
+
+    __device__
+    inline void reduce(double &accumulator, double accum) {
+        atomicAdd(&accumulator, accum);
+    }
+};  // edgeMap
+
+struct PR_vertex_F {
+    double oneOverN;
+
+    PR_vertex_F(double _oneOverN) : oneOverN(_oneOverN) {}
+
+    __device__
+    inline void operator() (Bench_Vertex &v, double accum) {
+        v.rank = 0.85 * accum + 0.15 * oneOverN;
+    }
+};  // vertexMap
+
+struct Init_F {
+    int    level;
+    double rank;
+
+    Init_F(int _level, double _rank) : level(_level), rank(_rank) {}
+
+    __device__
+    inline void operator() (Bench_Vertex &v, double accum) {
+        v.level = level;
+        v.rank = rank;
+    }
+};  // vertexMap
+
+/** Timings of one layout. */
+struct BenchResult {
+    double bfsMillis;
+    EdgeId bfsEdges;
+    double prMillis;
+    std::vector<int>    levels;
+    std::vector<double> ranks;
+};
+
+template<typename Graph>
+BenchResult runBench(Graph &graph, VertexId source, int rounds) {
+    BenchResult result;
+    Oliver<Bench_Vertex, Dump_Edge, double> ol;
+    ol.readGraph(graph);
+    VertexId n = graph.vertexCount;
+
+    VertexSubset all(n, true);
+    ol.vertexMap<Init_F>(all, Init_F(0x7fffffff, 1.0 / n));
+    VertexSubset frontier(n, source);
+    ol.vertexMap<Init_F>(frontier, Init_F(0, 1.0 / n));
+    VertexSubset edgeFrontier(n, false);
+
+    // Counts the traversed edges of the frontiers before expanding them.
+    result.bfsEdges = 0;
+    result.bfsMillis = 0;
+    while (frontier.size() > 0) {
+        frontier.workqueue.persist();
+        for (VertexId i = 0; i < frontier.size(); i++) {
+            VertexId v = frontier.workqueue[i];
+            result.bfsEdges += graph.vertices[v + 1] - graph.vertices[v];
+        }
+        double start = getTimeMillis();
+        ol.edgeFilter<BFS_edge_F, 1>(edgeFrontier, frontier, BFS_edge_F());
+        ol.vertexFilter<BFS_vertex_F, true>(frontier, edgeFrontier, BFS_vertex_F());
+        result.bfsMillis += getTimeMillis() - start;
+    }
+
+    double start = getTimeMillis();
+    for (int i = 0; i < rounds; i++) {
+        ol.edgeMap<PR_edge_F>(all, PR_edge_F());
+        ol.vertexMap<PR_vertex_F>(all, PR_vertex_F(1.0 / n));
+    }
+    result.prMillis = getTimeMillis() - start;
+
+    const Bench_Vertex *values = ol.getVertexValues();
+    for (VertexId v = 0; v < n; v++) {
+        result.levels.push_back(values[v].level);
+        result.ranks.push_back(values[v].rank);
+    }
+
+    all.del();
+    frontier.del();
+    edgeFrontier.del();
+    return result;
+}
+
+void report(const char *layout, size_t bytes, EdgeId edgeCount,
+            const BenchResult &r, int rounds) {
+    printf("%-10s %12llu bytes %6.2f bits/edge | BFS %9.2f ms %8.2f MTEPS"
+           " | PageRank %9.2f ms/round %8.2f MTEPS\n",
+           layout, (unsigned long long) bytes,
+           edgeCount > 0 ? 8.0 * bytes / edgeCount : 0.0,
+           r.bfsMillis, r.bfsEdges / r.bfsMillis / 1000,
+           r.prMillis / rounds, (double) edgeCount * rounds / r.prMillis / 1000);
+}
+
+int main(int argc, char **argv) {
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-s 0] [-round 10]");
+    VertexId source = cl.getOptionLongValue("-s", 0);
+    int rounds = cl.getOptionIntValue("-round", 10);
+
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+
+    // The rows are sorted by the compression, so it goes first. The plain
+    // edges are kept to run the same graph in both layouts.
+    ByteOffset compressedBytes = graph.compress(false);
+    unsigned char *compressedEdges = graph.compressedEdges;
+    graph.compressedEdges = NULL;
+    BenchResult plain = runBench(graph, source, rounds);
+    graph.compressedEdges = compressedEdges;
+    BenchResult packed = runBench(graph, source, rounds);
+
+    report("plain", sizeof(VertexId) * graph.edgeCount, graph.edgeCount, plain, rounds);
+    report("compressed", compressedBytes, graph.edgeCount, packed, rounds);
+
+    for (VertexId v = 0; v < graph.vertexCount; v++) {
+        if (plain.levels[v] != packed.levels[v] ||
+                fabs(plain.ranks[v] - packed.ranks[v]) > 1e-9) {
+            LOG(ERROR) << "Layouts disagree at vertex " << v;
+            return 1;
+        }
+    }
+    return 0;
+}
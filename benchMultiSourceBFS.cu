@@ -0,0 +1,176 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Compares BFS from many sources run one at a time with the multi-source BFS
+ * of 64 and 256 traversals per sweep. The summaries of every source, and the
+ * levels of the first batch, are checked to be the same.
+ */
+
+#include "multiSourceBFS.h"
+
+struct BFS_Vertex {
+    int level;
+};
+
+struct BFS_edge_F {
+    __device__
+    inline int gather(BFS_Vertex src, EdgeId outdegree, Dump_Edge edge) {
+        return src.level + 1;
+    }
+
+    __device__
+    inline void reduce(int &accumulator, int accum) {
+        accumulator = accum; // benign race happens
+    }
+};  // edgeFilter
+
+struct BFS_vertex_F {
+    __device__
+    inline void update(BFS_Vertex &v, int accum) { v.level = accum; }
+
+    __device__
+    inline bool cond(BFS_Vertex v, int accum) { return v.level == -1; }
+};  // vertexFilter
+
+struct BFS_init_F {
+    int level;
+
+    BFS_init_F(int _level) : level(_level) {}
+
+    __device__
+    inline void operator() (BFS_Vertex &v, int accum) { v.level = level; }
+};  // vertexMap
+
+/**
+ * Runs a top-down BFS from every source. Keeps the levels, in input ids, of
+ * the first `keep` sources.
+ */
+double runSingle(const CsrGraph<int, int> &graph, const std::vector<VertexId> &sources,
+                 std::vector<BFSSummary> &summaries, int keep, std::vector<int> &levels) {
+    VertexId n = graph.vertexCount;
+    Oliver<BFS_Vertex, Dump_Edge, int> ol;
+    ol.readGraph(graph);
+    VertexSubset all(n, true);
+    VertexSubset edgeFrontier(n, false);
+    summaries.resize(sources.size());
+    levels.resize(static_cast<size_t>(keep) * n);
+
+    double start = getTimeMillis();
+    for (size_t i = 0; i < sources.size(); i++) {
+        ol.vertexMap<BFS_init_F>(all, BFS_init_F(-1));
+        VertexSubset frontier(n, graph.toNewId(sources[i]));
+        ol.vertexMap<BFS_init_F>(frontier, BFS_init_F(0));
+        while (frontier.size() > 0) {
+            ol.edgeFilter<BFS_edge_F>(edgeFrontier, frontier, BFS_edge_F());
+            ol.vertexFilter<BFS_vertex_F, false>(frontier, edgeFrontier, BFS_vertex_F());
+        }
+        frontier.del();
+
+        const BFS_Vertex *values = ol.getVertexValues();
+        BFSSummary &s = summaries[i];
+        s.reached = 0;
+        s.distanceSum = 0;
+        s.eccentricity = 0;
+        for (VertexId v = 0; v < n; v++) {
+            int level = values[graph.toNewId(v)].level;
+            if (i < static_cast<size_t>(keep)) levels[i * n + v] = level;
+            if (level < 0) continue;
+            s.reached++;
+            s.distanceSum += level;
+            s.eccentricity = std::max(s.eccentricity, level);
+        }
+    }
+    double millis = getTimeMillis() - start;
+    all.del();
+    edgeFrontier.del();
+    return millis;
+}
+
+template<int Words>
+double runMulti(const CsrGraph<int, int> &graph, const std::vector<VertexId> &sources,
+                std::vector<BFSSummary> &summaries) {
+    MultiSourceBFS<Words> bfs(graph);
+    double start = getTimeMillis();
+    bfs.run(sources, summaries);
+    return getTimeMillis() - start;
+}
+
+bool sameSummaries(const char *mode, const std::vector<BFSSummary> &a,
+                   const std::vector<BFSSummary> &b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].reached != b[i].reached || a[i].distanceSum != b[i].distanceSum ||
+            a[i].eccentricity != b[i].eccentricity) {
+            LOG(ERROR) << mode << " disagrees at source " << i;
+            return false;
+        }
+    }
+    return true;
+}
+
+void report(const char *mode, double millis, size_t count) {
+    printf("%-10s %10.3f ms %9.3f ms/source\n", mode, millis, millis / count);
+}
+
+int main(int argc, char **argv) {
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-sources 256]");
+    int count = cl.getOptionIntValue("-sources", 256);
+
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+    VertexId n = graph.vertexCount;
+
+    // Sources spread over the ids by a multiplicative hash.
+    std::vector<VertexId> sources;
+    for (int i = 0; i < count; i++) {
+        sources.push_back(static_cast<VertexId>((i * 2654435761ULL) % n));
+    }
+
+    std::vector<BFSSummary> single, multi64, multi256;
+    const int keep = std::min(count, 8);
+    std::vector<int> singleLevels;
+    double singleMillis = runSingle(graph, sources, single, keep, singleLevels);
+    double multi64Millis = runMulti<1>(graph, sources, multi64);
+    double multi256Millis = runMulti<4>(graph, sources, multi256);
+    report("single", singleMillis, sources.size());
+    report("multi64", multi64Millis, sources.size());
+    report("multi256", multi256Millis, sources.size());
+
+    if (!sameSummaries("multi64", single, multi64) ||
+        !sameSummaries("multi256", single, multi256)) {
+        return 1;
+    }
+
+    // The table of levels of a batch.
+    MultiSourceBFS<1> bfs(graph);
+    std::vector<BFSSummary> summaries(keep);
+    std::vector<int> levels(static_cast<size_t>(keep) * n);
+    bfs.run(sources.data(), keep, summaries.data(), levels.data());
+    if (levels != singleLevels) {
+        LOG(ERROR) << "The levels of the multi-source BFS disagree";
+        return 1;
+    }
+    return 0;
+}
@@ -31,70 +31,246 @@
  *      Ye Li (mailly1994@gmail.com)
  *
  * Created on 2014-11-29
- * Last modified on 2014-11-30
+ * Last modified on 2015-04-02
  */
 
 #ifndef BITMAP_H
 #define BITMAP_H
 
 #include <algorithm>
+#include <vector>
 
 #include "common.h"
+#include "threadPool.h"
 
+/**
+ * Number of words below which the bulk operations of a bitmap run on the
+ * calling thread, and the chunk they are split into otherwise.
+ */
+const size_t BITMAP_GRAIN = 1 << 14;
+
+/**
+ * Word-level operations on a bitmap held in a plain array of words, such as
+ * a `GRD<Word>`. Bit `i` lives in word `i / 64`, at position `i % 64`. The
+ * bits past the end of the last word are kept clear, so that whole words
+ * can be counted and scanned.
+ */
+namespace bitmap {
+
+/** Number of bits in a word. */
+const int WORD_BITS = 64;
+
+/** Returns the number of words holding `n` bits. */
+__host__ __device__
+inline size_t wordCount(size_t n) {
+    return (n + WORD_BITS - 1) / WORD_BITS;
+}
+
+/** Returns the bits of the last word of an `n`-bit bitmap that are in use. */
+__host__ __device__
+inline Word tailMask(size_t n) {
+    return n % WORD_BITS == 0 ? ~static_cast<Word>(0) :
+           (static_cast<Word>(1) << (n % WORD_BITS)) - 1;
+}
+
+/** Returns whether bit `i` is set. */
+__host__ __device__
+inline bool get(const Word *words, size_t i) {
+    return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+/**
+ * Sets the bits of `mask` in `*word`. The word is shared with other threads,
+ * hence the atomic, which is saved if the bits are set already.
+ */
+__host__ __device__
+inline void setMask(Word *word, Word mask) {
+    if ((*word & mask) == mask) return;
+#ifdef __CUDA_ARCH__
+    atomicOr(reinterpret_cast<unsigned long long *>(word),
+             static_cast<unsigned long long>(mask));
+#else
+    __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+#endif
+}
+
+/** Sets bit `i`, atomically like `setMask`. */
+__host__ __device__
+inline void set(Word *words, size_t i) {
+    setMask(&words[i / WORD_BITS], static_cast<Word>(1) << (i % WORD_BITS));
+}
+
+/** Clears bit `i`, atomically like `set`. */
+__host__ __device__
+inline void unset(Word *words, size_t i) {
+    Word mask = static_cast<Word>(1) << (i % WORD_BITS);
+    if (!(words[i / WORD_BITS] & mask)) return;
+#ifdef __CUDA_ARCH__
+    atomicAnd(reinterpret_cast<unsigned long long *>(&words[i / WORD_BITS]),
+              static_cast<unsigned long long>(~mask));
+#else
+    __atomic_fetch_and(&words[i / WORD_BITS], ~mask, __ATOMIC_RELAXED);
+#endif
+}
+
+/**
+ * Returns the number of set bits of `w`. Without a popcount instruction
+ * the bits are summed in parallel within the word, which also vectorizes
+ * over an array of words.
+ */
+__host__ __device__
+inline int popcount(Word w) {
+#if defined(__CUDA_ARCH__)
+    return __popcll(w);
+#elif defined(__POPCNT__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    w += w >> 8;
+    w += w >> 16;
+    w += w >> 32;
+    return static_cast<int>(w & 0x7f);
+#endif
+}
+
+/** Returns the position of the lowest set bit of `w`, which is not 0. */
+__host__ __device__
+inline int lowestBit(Word w) {
+#ifdef __CUDA_ARCH__
+    return __ffsll(w) - 1;
+#else
+    return __builtin_ctzll(w);
+#endif
+}
+
+/**
+ * Returns the number of set bits of `words[0..n)`, counted a word at a time
+ * in chunks of `grain` words on the thread pool.
+ */
+inline size_t count(const Word *words, size_t n, size_t grain = BITMAP_GRAIN) {
+    size_t total = 0;
+    ThreadPool::get().parallelFor(n, [&](size_t begin, size_t end, int) {
+        size_t sum = 0;
+        for (size_t w = begin; w < end; w++) sum += popcount(words[w]);
+        __atomic_fetch_add(&total, sum, __ATOMIC_RELAXED);
+    }, grain);
+    return total;
+}
+
+/**
+ * Writes the indices of the set bits of `words[0..n)` to `out` by increasing
+ * index, and returns their number. The chunks of `grain` words are counted
+ * first, so that each knows where to write.
+ */
+template<typename Index>
+size_t toList(const Word *words, size_t n, Index *out, size_t grain = BITMAP_GRAIN) {
+    size_t chunks = (n + grain - 1) / grain;
+    std::vector<size_t> offsets(chunks + 1, 0);
+    ThreadPool &pool = ThreadPool::get();
+    pool.parallelFor(chunks, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; c++) {
+            size_t last = std::min((c + 1) * grain, n);
+            for (size_t w = c * grain; w < last; w++) {
+                offsets[c + 1] += popcount(words[w]);
+            }
+        }
+    }, 1);
+    for (size_t c = 0; c < chunks; c++) offsets[c + 1] += offsets[c];
+    pool.parallelFor(chunks, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; c++) {
+            size_t pos = offsets[c];
+            size_t last = std::min((c + 1) * grain, n);
+            for (size_t w = c * grain; w < last; w++) {
+                for (Word bits = words[w]; bits != 0; bits &= bits - 1) {
+                    out[pos++] = w * WORD_BITS + lowestBit(bits);
+                }
+            }
+        }
+    }, 1);
+    return offsets[chunks];
+}
+
+}  // namespace bitmap
+
+/**
+ * A bitmap whose bits can be tested and set on both sides: it lives in
+ * managed memory with the GPU backend, in host memory otherwise. The bulk
+ * operations (counting, algebra, iteration) run on the host a word at a
+ * time, in parallel on the thread pool for big bitmaps. With the GPU
+ * backend, the device must be synchronized before the host touches it.
+ *
+ * The bits past `capacity()` are always clear.
+ */
 class Bitmap : public Managed {
 private:
-    Word *words;
-    int numWords;
+    Word   *words;
+    size_t  numWords;
+    size_t  numBits;
 
 public:
-    Bitmap() : words(NULL), numWords(0) {}
+    Bitmap() : words(NULL), numWords(0), numBits(0) {}
 
     /**
-     * Allocate a bitmap initalize with zeros on unified memory
+     * Allocate a bitmap initalize with zeros
      *
-     * @param  numBits [number of bits in the bitmap]
+     * @param  bits [number of bits in the bitmap]
      */
-    explicit Bitmap(int numBits) {
-        numWords = ((numBits - 1) >> 6) + 1;
-        cudaMallocManaged(&words, numWords * sizeof(Word));
-        memset(words, 0, numWords * sizeof(Word));
+    explicit Bitmap(size_t bits) : numWords(bitmap::wordCount(bits)),
+        numBits(bits) {
+        words = allocate(numWords);
+        clear();
+    }
+
+    Bitmap(const Bitmap &other) : numWords(other.numWords),
+        numBits(other.numBits) {
+        words = allocate(numWords);
+        copyWords(other);
     }
+
     ~Bitmap() {
-        cudaFree(words);
+        release(words);
+    }
+
+    /**
+     * Deep copy a bitmap to myself, reusing my words if they fit.
+     *
+     * @param other The other bitmap
+     * @return      Result bitmap
+     */
+    Bitmap &operator= (const Bitmap &other) {
+        if (this == &other) return *this;
+        if (numWords != other.numWords) {
+            release(words);
+            numWords = other.numWords;
+            words = allocate(numWords);
+        }
+        numBits = other.numBits;
+        copyWords(other);
+        return *this;
     }
 
     /**
-     * Sets the bit at the specified index to 1. Both host and device side
+     * Sets the bit at the specified index to 1, atomically. Both host and
+     * device side
      *
      * @param index [the bit index]
      */
     inline __host__ __device__
-    void set(int index) {
-        Word bitmask = static_cast<Word>(1) << (index & 0x3f);
-#ifdef __CUDA_ARCH__
-        atomicOr(
-            reinterpret_cast<unsigned long long *>(&words[index >> 6]),
-            static_cast<unsigned long long>(bitmask) );
-#else
-        words[index >> 6] |= bitmask;
-#endif
+    void set(size_t index) {
+        bitmap::set(words, index);
     }
 
     /**
-     * Sets the bit at the specified index to 0. Both host and device side
+     * Sets the bit at the specified index to 0, atomically. Both host and
+     * device side
      *
      * @param index [the bit index]
      */
     inline __host__ __device__
-    void unset(int index) {
-        Word bitmask = static_cast<Word>(1) << (index & 0x3f);
-#ifdef __CUDA_ARCH__
-        atomicAnd(
-            reinterpret_cast<unsigned long long *>(&words[index >> 6]),
-            static_cast<unsigned long long>(~bitmask) );
-#else
-        words[index >> 6] &= ~bitmask;
-#endif
+    void unset(size_t index) {
+        bitmap::unset(words, index);
     }
 
     /**
@@ -104,9 +280,8 @@ public:
      * @return  [True if the bit is currently set]
      */
     inline __host__ __device__
-    bool get(int index) const {
-        Word bitmask = static_cast<Word>(1) << (index & 0x3f);
-        return (words[index >> 6] & bitmask) != 0;
+    bool get(size_t index) const {
+        return bitmap::get(words, index);
     }
 
     /**
@@ -114,87 +289,180 @@ public:
      * @return  [the capacity]
      */
     inline __host__ __device__
-    int capacity(void) const {
-        return numWords << 6;
+    size_t capacity(void) const {
+        return numBits;
+    }
+
+    /** The words of the bitmap, e.g. to hand them to a kernel. */
+    inline __host__ __device__
+    Word *data(void) const {
+        return words;
+    }
+
+    /** Clears all the bits. */
+    void clear() {
+        if (numWords > 0) memset(words, 0, numWords * sizeof(Word));
+    }
+
+    /** Returns the number of set bits. */
+    size_t count() const {
+        return bitmap::count(words, numWords);
     }
 
     /**
-     * Deep copy a bitmap to myself
-     *
-     * @param other The other bitmap
-     * @return      Result bitmap
+     * In-place algebra. The bits of `other` past its capacity count as
+     * clear, and the capacity of this bitmap does not change.
      */
-    Bitmap &operator= (const Bitmap &other) {
-        Word *temp = new Word[other.numWords];
-        memcpy(temp, other.words, other.numWords * sizeof(Word));
-        if (words != NULL) {
-            delete[] words;
-        }
-        words = temp;
-        numWords = other.numWords;
-        return * this;
+    Bitmap &operator&= (const Bitmap &other) {
+        size_t common = std::min(numWords, other.numWords);
+        const Word *rhs = other.words;
+        forWords([=](Word *lhs, size_t w) { lhs[w] &= w < common ? rhs[w] : 0; });
+        return *this;
+    }
+
+    Bitmap &operator|= (const Bitmap &other) {
+        const Word *rhs = other.words;
+        forWords([=](Word *lhs, size_t w) { lhs[w] |= rhs[w]; },
+                 std::min(numWords, other.numWords));
+        trimTail();
+        return *this;
+    }
+
+    Bitmap &operator^= (const Bitmap &other) {
+        const Word *rhs = other.words;
+        forWords([=](Word *lhs, size_t w) { lhs[w] ^= rhs[w]; },
+                 std::min(numWords, other.numWords));
+        trimTail();
+        return *this;
+    }
+
+    /** Clears the bits that are set in `other`. */
+    Bitmap &andNot(const Bitmap &other) {
+        const Word *rhs = other.words;
+        forWords([=](Word *lhs, size_t w) { lhs[w] &= ~rhs[w]; },
+                 std::min(numWords, other.numWords));
+        return *this;
     }
 
     /**
-     * Compute the bit-wise AND of two bitmaps and return it as result.
+     * Compute the bit-wise AND of two bitmaps and return it as result, as
+     * big as the bigger one. So are the other operators.
      *
      * @param other The other bitmap
      * @return      Result bitmap
      */
-    Bitmap operator& (const Bitmap &other) {
-        int numBitsBigger   = std::max(capacity(), other.capacity());
-        int numWordsSmaller = std::min(numWords, other.numWords);
-        Bitmap newBitmap(numBitsBigger);
-        for (int i = 0; i < numWordsSmaller; i++) {
-            newBitmap.words[i] = words[i] & other.words[i];
-        }
-        return newBitmap;
+    Bitmap operator& (const Bitmap &other) const {
+        Bitmap result(std::max(numBits, other.numBits));
+        result |= *this;
+        return result &= other;
+    }
+
+    /** Compute the bit-wise OR of two bitmaps and return it as result. */
+    Bitmap operator| (const Bitmap &other) const {
+        Bitmap result(std::max(numBits, other.numBits));
+        result |= *this;
+        return result |= other;
+    }
+
+    /** Compute the bit-wise XOR of two bitmaps and return it as result. */
+    Bitmap operator^ (const Bitmap &other) const {
+        Bitmap result(std::max(numBits, other.numBits));
+        result |= *this;
+        return result ^= other;
     }
 
     /**
-     * Compute the bit-wise OR of two bitmaps and return it as result.
-     *
-     * @param other The other bitmap
-     * @return      Result bitmap
+     * Returns the first set bit at or after `index`, or `capacity()` if
+     * there is none. Skips the clear words whole.
      */
-    Bitmap operator| (const Bitmap &other) {
-        int numBitsBigger   = std::max(capacity(), other.capacity());
-        int numWordsSmaller = std::min(numWords, other.numWords);
-        Bitmap newBitmap(numBitsBigger);
-        for (int i = 0; i < numWordsSmaller; i++) {
-            newBitmap.words[i] = words[i] | other.words[i];
-        }
-        // The bigger one lasts here and copys the rest of itself
-        for (int i = numWordsSmaller; i < numWords; i++) {
-            newBitmap.words[i] = words[i];
+    size_t nextSetBit(size_t index) const {
+        if (index >= numBits) return numBits;
+        size_t w = index / bitmap::WORD_BITS;
+        Word bits = words[w] & (~static_cast<Word>(0) << (index % bitmap::WORD_BITS));
+        while (bits == 0) {
+            if (++w == numWords) return numBits;
+            bits = words[w];
         }
-        for (int i = numWordsSmaller; i < other.numWords; i++) {
-            newBitmap.words[i] = other.words[i];
+        return w * bitmap::WORD_BITS + bitmap::lowestBit(bits);
+    }
+
+    /** Calls `f(index)` on every set bit, by increasing index. */
+    template<typename F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < numWords; w++) {
+            for (Word bits = words[w]; bits != 0; bits &= bits - 1) {
+                f(w * bitmap::WORD_BITS + bitmap::lowestBit(bits));
+            }
         }
-        return newBitmap;
     }
 
     /**
-     * Compute the bit-wise XOR of two bitmaps and return it as result.
-     *
-     * @param other The other bitmap
-     * @return      Result bitmap
+     * Calls `f(index)` on every set bit from the workers of the thread pool,
+     * by increasing index within a chunk of words.
      */
-    Bitmap operator^ (const Bitmap &other) {
-        int numBitsBigger   = std::max(capacity(), other.capacity());
-        int numWordsSmaller = std::min(numWords, other.numWords);
-        Bitmap newBitmap(numBitsBigger);
-        for (int i = 0; i < numWordsSmaller; i++) {
-            newBitmap.words[i] = words[i] ^ other.words[i];
-        }
-        // The bigger one lasts here and copys the rest of itself
-        for (int i = numWordsSmaller; i < numWords; i++) {
-            newBitmap.words[i] = words[i];
-        }
-        for (int i = numWordsSmaller; i < other.numWords; i++) {
-            newBitmap.words[i] = other.words[i];
-        }
-        return newBitmap;
+    template<typename F>
+    void parallelForEach(F f) const {
+        ThreadPool::get().parallelFor(numWords,
+        [&](size_t begin, size_t end, int) {
+            for (size_t w = begin; w < end; w++) {
+                for (Word bits = words[w]; bits != 0; bits &= bits - 1) {
+                    f(w * bitmap::WORD_BITS + bitmap::lowestBit(bits));
+                }
+            }
+        }, BITMAP_GRAIN);
+    }
+
+    /**
+     * Writes the indices of the set bits to `out` by increasing index, and
+     * returns their number.
+     */
+    template<typename Index>
+    size_t toList(Index *out) const {
+        return bitmap::toList(words, numWords, out);
+    }
+
+private:
+    /**
+     * Applies `op(words, w)` to the first `n` words (all by default), in
+     * chunks on the thread pool. The loops are simple enough to vectorize.
+     */
+    template<typename Op>
+    void forWords(Op op, size_t n = static_cast<size_t>(-1)) {
+        n = std::min(n, numWords);
+        Word *lhs = words;
+        ThreadPool::get().parallelFor(n, [=](size_t begin, size_t end, int) {
+            for (size_t w = begin; w < end; w++) op(lhs, w);
+        }, BITMAP_GRAIN);
+    }
+
+    /** Copies the words of a bitmap of the same size. */
+    void copyWords(const Bitmap &other) {
+        if (numWords > 0) memcpy(words, other.words, numWords * sizeof(Word));
+    }
+
+    /** Clears the bits past the capacity, which an operand may have set. */
+    void trimTail() {
+        if (numWords > 0) words[numWords - 1] &= bitmap::tailMask(numBits);
+    }
+
+    static Word *allocate(size_t n) {
+        if (n == 0) return NULL;
+#ifdef OLIVE_HOST
+        return static_cast<Word *>(malloc(n * sizeof(Word)));
+#else
+        Word *p;
+        CUDA_CHECK(cudaMallocManaged(&p, n * sizeof(Word)));
+        return p;
+#endif
+    }
+
+    static void release(Word *p) {
+        if (p == NULL) return;
+#ifdef OLIVE_HOST
+        free(p);
+#else
+        CUDA_CHECK(cudaFree(p));
+#endif
     }
 };
 
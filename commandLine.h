@@ -69,6 +69,14 @@ public:
     /**
      * prog ... -option value ...
      */
+    char *getOptionValue(std::string option, char *defaultValue = NULL) {
+        for (int i = 1; i < argc - 1; i++)
+            if ((std::string) argv[i] == option) {
+                return argv[i + 1];
+            }
+        return defaultValue;
+    }
+
     int getOptionIntValue(std::string option, int defaultValue) {
         for (int i = 1; i < argc - 1; i++)
             if ((std::string) argv[i] == option) {
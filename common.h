@@ -44,19 +44,50 @@
 #include <assert.h>
 #include <inttypes.h>
 
+/**
+ * Olive is built for the GPU when compiled by nvcc. Any other compiler builds
+ * the multithreaded host backend, in which the kernels are plain functions
+ * running on a pool of CPU threads (see oliverHost.h).
+ */
+#ifdef __CUDACC__
 #include "cuda_runtime.h"
+#else
+#define OLIVE_HOST
+#define __host__
+#define __device__
+#define __global__
+#endif
 
 
 /** One word equals 64 bit. */
 typedef uint64_t Word;
 
 
-/** Defines type of the number space for vertex id. */
+/**
+ * Defines type of the number space for vertex id.
+ *
+ * 32-bit ids are the default for cache density. Defining OLIVE_VERTEX_ID_64
+ * widens them for graphs with more than 4 billion vertices. The 64-bit type is
+ * `unsigned long long`, for which CUDA provides the atomic functions.
+ */
+#ifdef OLIVE_VERTEX_ID_64
+typedef unsigned long long VertexId;
+#else
 typedef uint32_t VertexId;
+#endif
 
 
-/** Defines the number space for edge id. */
+/**
+ * Defines the number space for edge id.
+ *
+ * Defining OLIVE_EDGE_ID_64 widens the edge offsets only, which lifts the
+ * limit of 4 billion edges while the per-edge adjacency stays 32-bit.
+ */
+#if defined(OLIVE_EDGE_ID_64) || defined(OLIVE_VERTEX_ID_64)
+typedef unsigned long long EdgeId;
+#else
 typedef uint32_t EdgeId;
+#endif
 
 
 /** Defines the type for the partition identifier. */
@@ -84,6 +115,36 @@ const int MAX_THREADS_PER_BLOCK = 1024;
  */
 const int MAX_BLOCKS = 65535;
 
+/**
+ * Number of partial results of a reduction over the vertices, i.e. blocks of
+ * its first pass. A power of two, as the second pass combines them in a
+ * single block.
+ */
+const int REDUCE_BLOCKS = 256;
+
+/**
+ * Maximum number of hubs, the destinations whose accumulators the push
+ * operators privatize. A block keeps a slot for each in shared memory.
+ */
+const int MAX_HUBS = 256;
+
+/**
+ * The hubs of a graph, passed by value to the push kernels. Edges into a hub
+ * are reduced into a private slot of the block (GPU) or of the worker
+ * (host), and the slots are reduced into the accumulators once at the end
+ * of the kernel, so that `f.reduce` does not serialize on a single address.
+ */
+template<typename AccumValue>
+struct HubAccumulators {
+    const Word     *flags;     /** Bit `v` is set if `v` is a hub */
+    const int      *slots;     /** The slot of every hub */
+    const VertexId *vertices;  /** The hub of every slot */
+    int             count;     /** Number of hubs, 0 disables privatization */
+    AccumValue      init;      /** What a slot of a block starts with */
+    AccumValue     *partials;  /** Host: `count` slots per worker */
+    int            *touched;   /** Host: whether each slot has been reduced to */
+};
+
 
 
 
@@ -97,6 +158,18 @@ const int MAX_BLOCKS = 65535;
 #define NUM_BLOCKS gridDim.x
 #define NUM_THREADS (blockDim.x * gridDim.x)
 
+/**
+ * Appends the launch configuration `c` (a pair returned by kernelConfig) to a
+ * kernel call. The host backend calls the kernel as an ordinary function.
+ */
+#ifdef OLIVE_HOST
+#define KERNEL_CONFIG(c)
+#else
+#define KERNEL_CONFIG(c) <<< (c).first, (c).second >>>
+#endif
+
+#ifndef OLIVE_HOST
+
 /**
  * A wrapper that asserts the success of CUDA calls
  * TODO(onesuper): replace it with a method which throws an exception
@@ -149,4 +222,102 @@ inline __device__ double atomicAdd(double* address, double val) {
   return __longlong_as_double(old);
 }
 
+#else  // OLIVE_HOST
+
+/** Objects of the host backend live in host memory, which both sides share. */
+class Managed {
+};
+
+/**
+ * Host counterparts of the CUDA atomic functions, so that the same user
+ * functors (e.g. `atomicMin` in SSSP) compile for the host backend.
+ * The operand is not used for deduction, so `atomicAdd(size, 1)` works on
+ * any integral counter like its CUDA counterpart.
+ */
+template<typename T>
+struct AtomicOperand {
+    typedef T type;
+};
+
+template<typename T>
+inline T atomicAdd(T *address, typename AtomicOperand<T>::type val) {
+    return __atomic_fetch_add(address, val, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline T atomicSub(T *address, typename AtomicOperand<T>::type val) {
+    return __atomic_fetch_sub(address, val, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline T atomicMin(T *address, typename AtomicOperand<T>::type val) {
+    T old = __atomic_load_n(address, __ATOMIC_RELAXED);
+    while (val < old && !__atomic_compare_exchange_n(address, &old, val, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    return old;
+}
+
+template<typename T>
+inline T atomicMax(T *address, typename AtomicOperand<T>::type val) {
+    T old = __atomic_load_n(address, __ATOMIC_RELAXED);
+    while (val > old && !__atomic_compare_exchange_n(address, &old, val, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    return old;
+}
+
+template<typename T>
+inline T atomicOr(T *address, typename AtomicOperand<T>::type val) {
+    return __atomic_fetch_or(address, val, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline T atomicAnd(T *address, typename AtomicOperand<T>::type val) {
+    return __atomic_fetch_and(address, val, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline T atomicExch(T *address, typename AtomicOperand<T>::type val) {
+    return __atomic_exchange_n(address, val, __ATOMIC_RELAXED);
+}
+
+template<typename T>
+inline T atomicCAS(T *address, typename AtomicOperand<T>::type compare,
+                   typename AtomicOperand<T>::type val) {
+    __atomic_compare_exchange_n(address, &compare, val, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return compare;
+}
+
+/** Floating-point adds are emulated with a CAS loop on the bit pattern. */
+template<typename T, typename Bits>
+inline T atomicAddFloating(T *address, T val) {
+    Bits *addressAsBits = reinterpret_cast<Bits *>(address);
+    Bits old = __atomic_load_n(addressAsBits, __ATOMIC_RELAXED);
+    Bits assumed;
+    T oldValue, newValue;
+    do {
+        assumed = old;
+        memcpy(&oldValue, &assumed, sizeof(T));
+        newValue = oldValue + val;
+        memcpy(&old, &newValue, sizeof(T));
+        if (__atomic_compare_exchange_n(addressAsBits, &assumed, old, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return oldValue;
+        }
+        old = assumed;
+    } while (true);
+}
+
+template<>
+inline double atomicAdd(double *address, double val) {
+    return atomicAddFloating<double, uint64_t>(address, val);
+}
+
+template<>
+inline float atomicAdd(float *address, float val) {
+    return atomicAddFloating<float, uint32_t>(address, val);
+}
+
+#endif  // OLIVE_HOST
+
 #endif  // COMMON_H
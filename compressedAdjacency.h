@@ -0,0 +1,246 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Gap-encoded adjacency lists.
+ */
+
+#ifndef COMPRESSED_ADJACENCY_H
+#define COMPRESSED_ADJACENCY_H
+
+#include <string.h>
+#include <algorithm>
+
+#include "common.h"
+
+/**
+ * Byte offset into the compressed adjacency. It is 64-bit regardless of the
+ * id widths, since a row may take more bytes than it has edges.
+ */
+typedef unsigned long long ByteOffset;
+
+/**
+ * Number of edges in a block. Blocks are decoded independently of each other,
+ * so the lanes sharing a long adjacency list can split it by blocks.
+ */
+const EdgeId COMPRESSED_BLOCK_SIZE = 64;
+
+/**
+ * Bytes of zeros after the last row, so that the decoder can always load
+ * a whole 64-bit word.
+ */
+const ByteOffset COMPRESSED_PADDING = 8;
+
+/**
+ * Layout of a row (the adjacency list of a vertex with `d` > 0 edges):
+ * {{{
+ * | offsets of block 1..n-1 (4 bytes each) | block 0 | block 1 | ... |
+ * }}}
+ * where n = ceil(d / COMPRESSED_BLOCK_SIZE) and the offsets are relative to
+ * the start of the row, stored little-endian byte by byte so that they need no
+ * alignment. A block of `m` edges is laid out as:
+ * {{{
+ * | first neighbor (varint) | width (1 byte) | m - 1 gaps of `width` bits |
+ * }}}
+ * The first neighbor is stored as the zig-zag encoded difference to the
+ * source id, in a LEB128 varint (7 bits per byte, with the high bit set on
+ * all but the last byte). Each following neighbor is stored as the gap to its
+ * predecessor, bit-packed LSB first at the width of the widest gap of the
+ * block. Fixed-width gaps decode without any data-dependent branch.
+ *
+ * Rows have to be sorted by destination for the gaps to be non-negative.
+ */
+namespace compressed {
+
+/** Number of blocks of a row of `degree` edges. */
+__host__ __device__
+inline EdgeId numBlocks(EdgeId degree) {
+    return (degree + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE;
+}
+
+/** Returns where block `b` of the row starting at `row` begins. */
+__host__ __device__
+inline const unsigned char *blockStart(const unsigned char *row, EdgeId blocks,
+                                       EdgeId b) {
+    if (b == 0) return row + 4 * (blocks - 1);
+    const unsigned char *entry = row + 4 * (b - 1);
+    uint32_t offset = entry[0] | (entry[1] << 8) | (entry[2] << 16) |
+                      (static_cast<uint32_t>(entry[3]) << 24);
+    return row + offset;
+}
+
+/** Reads a varint and advances `p` past it. */
+__host__ __device__
+inline unsigned long long readVarint(const unsigned char *&p) {
+    unsigned long long x = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = *p++;
+        x |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return x;
+}
+
+/** Loads 8 bytes little-endian from an unaligned address. */
+__host__ __device__
+inline unsigned long long loadWord(const unsigned char *p) {
+#ifdef __CUDA_ARCH__
+    unsigned long long x = 0;
+    for (int i = 7; i >= 0; i--) {
+        x = (x << 8) | p[i];
+    }
+    return x;
+#else
+    unsigned long long x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+#endif
+}
+
+/** Reads `width` bits starting at bit `pos` of `bits`. */
+__host__ __device__
+inline unsigned long long readBits(const unsigned char *bits,
+                                   unsigned long long pos, int width) {
+    const unsigned char *q = bits + (pos >> 3);
+    int shift = pos & 7;
+    unsigned long long x = loadWord(q) >> shift;
+    if (shift + width > 64) x |= static_cast<unsigned long long>(q[8]) << (64 - shift);
+    return width == 64 ? x : x & ((1ULL << width) - 1);
+}
+
+/**
+ * Decodes the neighbors of a block one after another. `dst` is the current
+ * neighbor, starting at the first one.
+ */
+struct BlockDecoder {
+    VertexId             dst;
+    const unsigned char *bits;
+    unsigned long long   pos;
+    int                  width;
+
+    __host__ __device__
+    BlockDecoder(const unsigned char *block, VertexId src) : pos(0) {
+        unsigned long long z = readVarint(block);
+        long long delta = static_cast<long long>(z >> 1) ^ -static_cast<long long>(z & 1);
+        dst = static_cast<VertexId>(static_cast<long long>(src) + delta);
+        width = *block;
+        bits = block + 1;
+    }
+
+    /** Advances to the next neighbor. */
+    __host__ __device__
+    inline void next() {
+        dst += readBits(bits, pos, width);
+        pos += width;
+    }
+};
+
+inline int varintBytes(unsigned long long x) {
+    int n = 1;
+    while (x >= 0x80) {
+        x >>= 7;
+        n++;
+    }
+    return n;
+}
+
+inline unsigned char *writeVarint(unsigned char *p, unsigned long long x) {
+    while (x >= 0x80) {
+        *p++ = static_cast<unsigned char>(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = static_cast<unsigned char>(x);
+    return p;
+}
+
+inline unsigned long long zigzag(VertexId src, VertexId dst) {
+    long long delta = static_cast<long long>(dst) - static_cast<long long>(src);
+    return (static_cast<unsigned long long>(delta) << 1) ^
+           static_cast<unsigned long long>(delta >> 63);
+}
+
+/** Number of bits needed by `x`. */
+inline int bitWidth(unsigned long long x) {
+    int n = 0;
+    while (x > 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Returns the number of bytes of the row of `src`, and writes the row to
+ * `out` unless it is NULL. `out` must be zeroed.
+ */
+inline ByteOffset encodeRow(VertexId src, const VertexId *neighbors,
+                            EdgeId degree, unsigned char *out) {
+    if (degree == 0) return 0;
+    EdgeId blocks = numBlocks(degree);
+    ByteOffset size = 4 * (blocks - 1);
+    for (EdgeId b = 0; b < blocks; b++) {
+        if (b > 0 && out != NULL) {
+            unsigned char *entry = out + 4 * (b - 1);
+            entry[0] = size & 0xff;
+            entry[1] = (size >> 8) & 0xff;
+            entry[2] = (size >> 16) & 0xff;
+            entry[3] = (size >> 24) & 0xff;
+        }
+        EdgeId first = b * COMPRESSED_BLOCK_SIZE;
+        EdgeId last = first + COMPRESSED_BLOCK_SIZE < degree ?
+                      first + COMPRESSED_BLOCK_SIZE : degree;
+
+        unsigned long long z = zigzag(src, neighbors[first]);
+        int width = 0;
+        for (EdgeId e = first + 1; e < last; e++) {
+            width = std::max(width, bitWidth(neighbors[e] - neighbors[e - 1]));
+        }
+        if (out != NULL) {
+            unsigned char *p = writeVarint(out + size, z);
+            *p++ = static_cast<unsigned char>(width);
+            unsigned long long pos = 0;
+            for (EdgeId e = first + 1; e < last; e++, pos += width) {
+                unsigned long long gap = neighbors[e] - neighbors[e - 1];
+                unsigned long long bit = pos;
+                for (int left = width; left > 0; ) {
+                    int shift = bit & 7;
+                    int n = std::min(8 - shift, left);
+                    p[bit >> 3] |= (gap & ((1U << n) - 1)) << shift;
+                    gap >>= n;
+                    bit += n;
+                    left -= n;
+                }
+            }
+        }
+        size += varintBytes(z) + 1 + (static_cast<ByteOffset>(last - first - 1) * width + 7) / 8;
+    }
+    return size;
+}
+
+}  // namespace compressed
+
+#endif  // COMPRESSED_ADJACENCY_H
@@ -39,15 +39,51 @@
 #include <utility>
 #include <algorithm>
 #include <iostream>
+#include <atomic>
 
+#include "commandLine.h"
 #include "common.h"
+#include "compressedAdjacency.h"
 #include "edgeTuple.h"
+#include "graphGenerator.h"
+#include "mappedFile.h"
+#include "threadPool.h"
 #include "partitionStrategy.h"
+#include "vertexOrdering.h"
 #include "logging.h"
 #include "utils.h"
 #include "timer.h"
 
 
+/**
+ * Header of the binary CSR snapshot. The four arrays follow it in the file,
+ * each starting at a 64-byte aligned offset, so that a mapped snapshot can
+ * be used in place.
+ *
+ * The widths of the ids and values are recorded to reject a snapshot written
+ * by a build with different types.
+ */
+struct CsrGraphHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertexIdBytes;
+    uint32_t edgeIdBytes;
+    uint32_t vertexValueBytes;
+    uint32_t edgeValueBytes;
+    uint32_t reserved;
+    uint64_t vertexCount;
+    uint64_t edgeCount;
+    uint64_t verticesOffset;
+    uint64_t edgesOffset;
+    uint64_t edgeValuesOffset;
+    uint64_t vertexValuesOffset;
+};
+
+const char     CSR_GRAPH_MAGIC[8] = {'O', 'L', 'I', 'V', 'E', 'C', 'S', 'R'};
+const uint32_t CSR_GRAPH_VERSION = 1;
+const uint64_t CSR_GRAPH_ALIGNMENT = 64;
+
+
 /**
  * CSR graph representation.
  */
@@ -64,14 +100,38 @@ public:
     EdgeValue   *edgeValues;
     VertexValue *vertexValues;
 
+    /**
+     * Gap-encoded adjacency built by `compress()`. The row of vertex `v` takes
+     * bytes [compressedOffsets[v], compressedOffsets[v + 1]). NULL if the
+     * graph is not compressed.
+     */
+    unsigned char *compressedEdges;
+    ByteOffset    *compressedOffsets;
+
+    /**
+     * The transpose (CSC) built by `buildIncoming()`: the in-neighbors of `v`
+     * are inEdges[inVertices[v]..inVertices[v + 1]), sorted by id, and
+     * inEdgeValues holds the values of the same edges. NULL if not built.
+     */
+    EdgeId      *inVertices;
+    VertexId    *inEdges;
+    EdgeValue   *inEdgeValues;
+
+    /**
+     * Maps the id of each vertex in the input to its id in the graph after
+     * `reorder()`. NULL if the graph keeps the ids of the input.
+     */
+    VertexId    *newIds;
+
     CsrGraph(): vertexCount(0), edgeCount(0), vertices(NULL), edges(NULL),
-        edgeValues(NULL), vertexValues(NULL) {}
+        edgeValues(NULL), vertexValues(NULL), compressedEdges(NULL),
+        compressedOffsets(NULL), inVertices(NULL), inEdges(NULL),
+        inEdgeValues(NULL), newIds(NULL) {}
 
     ~CsrGraph() {
-        if (vertices) delete vertices;
-        if (edges) delete edges;
-        if (edgeValues) delete edgeValues;
-        if (vertexValues) delete vertexValues;
+        releaseIndexes();
+        releaseBuffers();
+        if (newIds) delete[] newIds;
     }
 
     void initGraph(VertexId _vertexCount, EdgeId _edgeCount) {
@@ -85,100 +145,281 @@ public:
 
     /**
      * Load the graph from an edge list file where each line contains two
-     * integers: a source id and a target id. Skips lines that begin with `#`.
+     * integers: a source id and a target id, and an optional edge value.
+     * Skips lines that begin with `#`.
+     *
+     * The file is memory-mapped and split into newline-aligned chunks, which
+     * are parsed in parallel by the thread pool: the first pass counts the
+     * edge lines in each chunk, the second parses each chunk straight into
+     * its slice of the edge tuples.
      *
      * @note If a graph is loaded from  a edge list file, the type vertex value
      * is `int`. Meanwhile, the vertex-associated data is given a meaningless
-     * value (0 by default).
+     * value (0 by default). The edge value is parsed as an `EdgeValue`, and is
+     * 1 for lines without it.
      *
      * @example Loads a file in the following format:
      * {{{
      * # Comment Line
-     * # Source Id  Target Id
-     * 1    5
-     * 1    2
-     * 2    7
-     * 1    8
+     * # Source Id  Target Id  <Edge Value>
+     * 1    5    3
+     * 1    2    1
+     * 2    7    4
+     * 1    8    2
      * }}}
      *
      * @param path The path to the graph
+     * @return False if the file can not be read
      */
-    void fromEdgeListFile(const char *path) {
-        FILE *file = fopen(path, "r");
-        if (file == NULL) {
-            LOG(ERROR) << "Can not open graph file: " << path;
-            return;
-        }
+    bool fromEdgeListFile(const char *path) {
+        MappedFile file;
+        if (!file.map(path)) return false;
+        file.adviseSequential();
 
         Stopwatch stopwatch;
         stopwatch.start();
 
-        char line[1024];
-        typedef EdgeTuple<int> EdgeTupleInt;
-        EdgeId parsedEdges = VertexId(-1);
-        long long llnodes, lledges;
-
-        // Cache the parsed edge tuples in the buffer.
-        EdgeTupleInt *tuples;
-
-        while (fscanf(file, "%[^\n]\n", line) > 0) {
-            switch (line[0]) {
-            case '#': // Skip the comment
+        // The first line which is not a comment gives the vertex and edge
+        // numbers. Edge lines start right after it.
+        const char *p = file.begin();
+        const char *end = file.end();
+        unsigned long long llnodes = 0, lledges = 0;
+        while (p < end) {
+            const char *q = util::skipBlanks(p, end);
+            if (q < end && isdigit(*q)) {
+                q = util::parseUnsigned(q, end, llnodes);
+                if (q) q = util::parseUnsigned(q, end, lledges);
+                if (q == NULL) {
+                    LOG(ERROR) << "Bad header line in graph file: " << path;
+                    file.unmap();
+                    return false;
+                }
+                p = util::nextLine(q, end);
                 break;
-            default:
-                if (parsedEdges == VertexId(-1)) {
-                    sscanf(line, "%lld %lld", &llnodes, &lledges);
-                    LOG(INFO) << "Parsing graph: " << llnodes << " nodes, " << lledges << " edges";
-                    assert(llnodes > 0);
-                    tuples = (EdgeTupleInt *) malloc(lledges * sizeof(EdgeTupleInt));
-                    initGraph(llnodes, lledges);
-                    parsedEdges = 0;
-                } else {
-                    long long llsrc, lldst;
-                    sscanf(line, "%lld %lld", &llsrc, &lldst);
-                    tuples[parsedEdges] = EdgeTupleInt(llsrc, lldst, 1);
-                    parsedEdges++;
+            }
+            p = util::nextLine(p, end);
+        }
+        LOG(INFO) << "Parsing graph: " << llnodes << " nodes, " << lledges << " edges";
+        assert(llnodes > 0);
+
+        // Splits the body into newline-aligned chunks.
+        ThreadPool &pool = ThreadPool::get();
+        size_t numChunks = static_cast<size_t>(pool.size()) * 4;
+        size_t chunkBytes = (end - p) / numChunks + 1;
+        std::vector<const char *> chunks(numChunks + 1, end);
+        chunks[0] = p;
+        for (size_t i = 1; i < numChunks; i++) {
+            const char *c = chunks[i - 1] + chunkBytes;
+            chunks[i] = c < end ? util::nextLine(c, end) : end;
+        }
+
+        // Pass 1: counts the edge lines in each chunk.
+        std::vector<EdgeId> chunkEdges(numChunks + 1, 0);
+        pool.parallelFor(numChunks, [&](size_t begin, size_t last, int) {
+            for (size_t i = begin; i < last; i++) {
+                EdgeId count = 0;
+                for (const char *l = chunks[i]; l < chunks[i + 1];
+                        l = util::nextLine(l, chunks[i + 1])) {
+                    const char *q = util::skipBlanks(l, chunks[i + 1]);
+                    if (q < chunks[i + 1] && isdigit(*q)) count++;
                 }
+                chunkEdges[i] = count;
             }
+        }, 1);
+
+        // Exclusive prefix sum gives the first edge of every chunk.
+        EdgeId parsedEdges = 0;
+        for (size_t i = 0; i <= numChunks; i++) {
+            EdgeId count = chunkEdges[i];
+            chunkEdges[i] = parsedEdges;
+            parsedEdges += count;
+        }
+        if (parsedEdges != lledges) {
+            LOG(ERROR) << "Expect " << lledges << " edges, but " << parsedEdges
+                       << " edge lines found";
+            assert(0);
         }
 
+        // Pass 2: parses the chunks into their slices of the edge tuples.
+        typedef EdgeTuple<EdgeValue> Tuple;
+        Tuple *tuples = reinterpret_cast<Tuple *>(
+            malloc(std::max<EdgeId>(parsedEdges, 1) * sizeof(Tuple)));
+        pool.parallelFor(numChunks, [&](size_t begin, size_t last, int) {
+            for (size_t i = begin; i < last; i++) {
+                EdgeId e = chunkEdges[i];
+                const char *chunkEnd = chunks[i + 1];
+                for (const char *l = chunks[i]; l < chunkEnd;
+                        l = util::nextLine(l, chunkEnd)) {
+                    unsigned long long llsrc, lldst;
+                    const char *q = util::parseUnsigned(l, chunkEnd, llsrc);
+                    if (q == NULL) continue;  // comment or blank line
+                    q = util::parseUnsigned(q, chunkEnd, lldst);
+                    assert(q != NULL);
+                    EdgeValue value;
+                    const char *r = util::parseValue(q, chunkEnd, value);
+                    if (r == NULL) {
+                        value = 1;
+                    } else {
+                        q = r;
+                    }
+                    tuples[e++] = Tuple(llsrc, lldst, value);
+                    l = q;
+                }
+            }
+        }, 1);
+
+        double millis = stopwatch.getElapsedMillis();
+        LOG(INFO) << "It took " << millis << "ms to parse " << parsedEdges
+                  << " edge tuples (" << file.size() / millis / 1e6 << " GB/s).";
+        file.unmap();
+
+        fromEdgeTuples(llnodes, tuples, parsedEdges);
+        free(tuples);
+
         LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
-                  << "ms to parse " << parsedEdges << " edge tuples.";
+                  << "ms to generate the CSR graph from edge list file.";
+        return true;
+    }
 
-        // Generate the edge list by clustering the edge tuples by src Id.
-        // std::stable_sort(tuples, tuples + edgeCount, edgeTupleSrcCompare<EdgeTupleInt>);
+    /**
+     * Builds the graph from `n` edge tuples given in any order.
+     *
+     * The tuples are radix sorted by (`srcId`, `dstId`) first. The offsets
+     * then come from a parallel out-degree count and a prefix sum over it,
+     * and the sorted tuples are scattered to their rows, which end up sorted
+     * by destination. The whole build is O(n) with one extra tuple buffer.
+     *
+     * @note The content of `tuples` is clobbered.
+     *
+     * @param numVertices  Number of the vertices in the graph
+     * @param tuples       The edge tuples
+     * @param n            Number of the edge tuples
+     */
+    void fromEdgeTuples(VertexId numVertices, EdgeTuple<EdgeValue> *tuples, EdgeId n) {
+        initGraph(numVertices, n);
+
+        // Check the ids before they are used as offsets.
+        ThreadPool &pool = ThreadPool::get();
+        std::atomic<bool> outOfRange(false);
+        pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+            for (EdgeId e = begin; e < end; e++) {
+                if (tuples[e].srcId >= vertexCount || tuples[e].dstId >= vertexCount) {
+                    outOfRange = true;
+                }
+            }
+        }, 1 << 16);
+        if (outOfRange) {
+            LOG(ERROR) << "Vertex id out of range [0, " << vertexCount << ")";
+            assert(0);
+        }
 
-        VertexId prevSrc = VertexId(-1);
-        for (EdgeId e = 0; e < edgeCount; e++) {
-            edges[e] = tuples[e].dstId;
-            VertexId src = tuples[e].srcId;
-            // Fill up the missing `src`s
-            for (VertexId v = prevSrc + 1; v <= src; v++) {
-                vertices[v] = e;
+        // Files that are already sorted skip the sort.
+        std::atomic<bool> isSorted(true);
+        pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+            for (EdgeId e = std::max<size_t>(begin, 1); e < end; e++) {
+                if (edgeTupleSrcDstCompare(tuples[e], tuples[e - 1])) {
+                    isSorted = false;
+                    return;
+                }
             }
-            prevSrc = src;
+        }, 1 << 16);
+
+        typedef EdgeTuple<EdgeValue> Tuple;
+        Tuple *sorted = tuples;
+        Tuple *buffer = NULL;
+        if (!isSorted) {
+            buffer = reinterpret_cast<Tuple *>(malloc(n * sizeof(Tuple)));
+            radixSortEdgeTuples(sorted, buffer, n, vertexCount - 1);
         }
 
-        // Fill out trailing vertices whose has not connecting edges.
-        for (VertexId v = prevSrc + 1; v <= vertexCount; v++) {
-            vertices[v] = edgeCount;
+        // Out-degree count into vertices[0..V), turned into offsets by an
+        // exclusive scan over vertices[0..V].
+        memset(vertices, 0, sizeof(EdgeId) * (vertexCount + 1));
+        pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+            for (EdgeId e = begin; e < end; e++) {
+                util::fetchAdd(&vertices[sorted[e].srcId], EdgeId(1));
+            }
+        }, 1 << 16);
+        util::prefixSum(vertices, vertexCount + 1);
+
+        // Scatter. The tuples of a row are consecutive and in order after the
+        // sort, so the e-th tuple lands at the e-th edge slot.
+        pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+            for (EdgeId e = begin; e < end; e++) {
+                edges[e] = sorted[e].dstId;
+                edgeValues[e] = sorted[e].value;
+            }
+        }, 1 << 16);
+
+        // Free our buffer, which is `sorted` after an odd number of passes.
+        if (buffer) free(sorted != tuples ? sorted : buffer);
+    }
+
+
+    /**
+     * Generates a synthetic graph in memory, see `generator::generateEdgeTuples`
+     * for the specs, e.g. "rmat:24" or "grid2d:1000:1000". The same spec and
+     * seed always give the same graph.
+     *
+     * @param spec       The kind of graph and its sizes
+     * @param seed       The seed of the random numbers
+     * @param maxWeight  Edge values are drawn from [1, maxWeight]
+     * @return False if the spec is invalid, or too big for the vertex and
+     *         edge ids
+     */
+    bool fromGenerator(const char *spec, unsigned long long seed = 1, int maxWeight = 1) {
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        VertexId n = 0;
+        EdgeId m = 0;
+        EdgeTuple<EdgeValue> *tuples =
+            generator::generateEdgeTuples<EdgeValue>(spec, seed, maxWeight, n, m);
+        if (tuples == NULL) {
+            LOG(ERROR) << "Invalid graph spec: " << spec;
+            return false;
         }
+        LOG(INFO) << "Generating graph " << spec << ": " << n << " nodes, " << m
+                  << " edges";
 
-        if (tuples) free(tuples);
+        fromEdgeTuples(n, tuples, m);
+        free(tuples);
+        memset(vertexValues, 0, sizeof(VertexValue) * vertexCount);
 
         LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
-                  << "ms to generate the CSR graph from edge list file.";
+                  << "ms to generate the CSR graph.";
+        return true;
     }
 
+    /**
+     * Loads the graph given on the command line of an app: `-gen <spec>`
+     * generates it with `-seed` and `-maxweight`, otherwise the first argument
+     * is read as an edge list, a Dimacs file with `-dimacs`, or a snapshot
+     * with `-binary`.
+     *
+     * @return False if the graph can not be generated or read
+     */
+    bool fromCommandLine(CommandLine &cl) {
+        char *spec = cl.getOptionValue("-gen");
+        if (spec) {
+            return fromGenerator(spec, cl.getOptionLongValue("-seed", 1),
+                                 cl.getOptionIntValue("-maxweight", 1));
+        }
+        char *path = cl.getArgument(0);
+        if (cl.getOption("-dimacs")) return fromDimacsFile(path);
+        if (cl.getOption("-binary")) return fromBinaryFile(path);
+        return fromEdgeListFile(path);
+    }
 
     /**
      * From dimacs graph format
+     * @return False if the file can not be opened
      */
-    void fromDimacsFile(const char *path) {
+    bool fromDimacsFile(const char *path) {
         FILE *file = fopen(path, "r");
         if (file == NULL) {
             LOG(ERROR) << "Can not open graph file: " << path;
-            return;
+            return false;
         }
 
         Stopwatch stopwatch;
@@ -231,8 +472,375 @@ public:
             assert(0);
         }
 
+        // The graph is unweighted
+        for (EdgeId e = 0; e < edgeCount; e++) {
+            edgeValues[e] = 1;
+        }
+
         LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
                   << "ms to generate the CSR graph from Dimacs file.";
+        return true;
+    }
+
+    /**
+     * Writes the graph to a binary snapshot, which can be loaded back with
+     * `fromBinaryFile`.
+     *
+     * @param path The path to the snapshot
+     * @return     False if the file can not be written
+     */
+    bool saveBinaryFile(const char *path) const {
+        if (edges == NULL) {
+            LOG(ERROR) << "Can not save a compressed graph without its edges";
+            return false;
+        }
+        FILE *file = fopen(path, "wb");
+        if (file == NULL) {
+            LOG(ERROR) << "Can not open snapshot file: " << path;
+            return false;
+        }
+
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        CsrGraphHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CSR_GRAPH_MAGIC, sizeof(header.magic));
+        header.version = CSR_GRAPH_VERSION;
+        header.vertexIdBytes = sizeof(VertexId);
+        header.edgeIdBytes = sizeof(EdgeId);
+        header.vertexValueBytes = sizeof(VertexValue);
+        header.edgeValueBytes = sizeof(EdgeValue);
+        header.vertexCount = vertexCount;
+        header.edgeCount = edgeCount;
+
+        uint64_t offset = alignUp(sizeof(CsrGraphHeader));
+        header.verticesOffset = offset;
+        offset = alignUp(offset + sizeof(EdgeId) * (vertexCount + 1));
+        header.edgesOffset = offset;
+        offset = alignUp(offset + sizeof(VertexId) * edgeCount);
+        header.edgeValuesOffset = offset;
+        offset = alignUp(offset + sizeof(EdgeValue) * edgeCount);
+        header.vertexValuesOffset = offset;
+
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        uint64_t written = sizeof(header);
+        ok = ok && writeAt(file, written, header.verticesOffset, vertices,
+                           sizeof(EdgeId) * (vertexCount + 1));
+        ok = ok && writeAt(file, written, header.edgesOffset, edges,
+                           sizeof(VertexId) * edgeCount);
+        ok = ok && writeAt(file, written, header.edgeValuesOffset, edgeValues,
+                           sizeof(EdgeValue) * edgeCount);
+        ok = ok && writeAt(file, written, header.vertexValuesOffset, vertexValues,
+                           sizeof(VertexValue) * vertexCount);
+        ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            LOG(ERROR) << "Failed to write snapshot file: " << path;
+            return false;
+        }
+
+        LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
+                  << "ms to write " << written << " bytes of CSR snapshot.";
+        return true;
+    }
+
+    /**
+     * Loads a binary snapshot written by `saveBinaryFile`.
+     *
+     * The file is mapped rather than read, and the buffers of the graph point
+     * straight into the mapping. Pages are only faulted in when touched, and
+     * are copied privately if the graph gets modified. The header is checked
+     * against the file: every section has to be aligned and in bounds, and the
+     * counts have to fit the ids of the build. The edges themselves are not.
+     *
+     * @param path The path to the snapshot
+     * @return False if the file can not be mapped or is not a valid snapshot,
+     *         in which case the graph is left empty
+     */
+    bool fromBinaryFile(const char *path) {
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        releaseIndexes();
+        releaseBuffers();
+        vertexCount = 0;
+        edgeCount = 0;
+        if (!mapping.map(path, true)) return false;
+
+        const CsrGraphHeader *header =
+            reinterpret_cast<const CsrGraphHeader *>(mapping.begin());
+        if (mapping.size() < sizeof(CsrGraphHeader) ||
+                memcmp(header->magic, CSR_GRAPH_MAGIC, sizeof(header->magic)) != 0) {
+            LOG(ERROR) << "Not a CSR snapshot: " << path;
+            mapping.unmap();
+            return false;
+        }
+        if (header->version != CSR_GRAPH_VERSION ||
+                header->vertexIdBytes != sizeof(VertexId) ||
+                header->edgeIdBytes != sizeof(EdgeId) ||
+                header->vertexValueBytes != sizeof(VertexValue) ||
+                header->edgeValueBytes != sizeof(EdgeValue)) {
+            LOG(ERROR) << "Incompatible CSR snapshot (version " << header->version
+                       << "): " << path;
+            mapping.unmap();
+            return false;
+        }
+        // The sections follow the header in this order, and the counts leave
+        // `VertexId(-1)` and `EdgeId(-1)` out like the generators do.
+        uint64_t end = sizeof(CsrGraphHeader);
+        bool valid =
+            header->vertexCount < static_cast<uint64_t>(static_cast<VertexId>(-1)) &&
+            header->edgeCount < static_cast<uint64_t>(static_cast<EdgeId>(-1)) &&
+            sectionFits(header->verticesOffset, header->vertexCount + 1,
+                        sizeof(EdgeId), end) &&
+            sectionFits(header->edgesOffset, header->edgeCount,
+                        sizeof(VertexId), end) &&
+            sectionFits(header->edgeValuesOffset, header->edgeCount,
+                        sizeof(EdgeValue), end) &&
+            sectionFits(header->vertexValuesOffset, header->vertexCount,
+                        sizeof(VertexValue), end);
+        char *base = const_cast<char *>(mapping.begin());
+        if (valid) {
+            const EdgeId *offsets =
+                reinterpret_cast<const EdgeId *>(base + header->verticesOffset);
+            valid = offsets[0] == 0 && offsets[header->vertexCount] == header->edgeCount;
+        }
+        if (!valid) {
+            LOG(ERROR) << "Corrupt or truncated CSR snapshot: " << path;
+            mapping.unmap();
+            return false;
+        }
+
+        vertexCount = header->vertexCount;
+        edgeCount = header->edgeCount;
+        vertices = reinterpret_cast<EdgeId *>(base + header->verticesOffset);
+        edges = reinterpret_cast<VertexId *>(base + header->edgesOffset);
+        edgeValues = reinterpret_cast<EdgeValue *>(base + header->edgeValuesOffset);
+        vertexValues = reinterpret_cast<VertexValue *>(base + header->vertexValuesOffset);
+
+        LOG(INFO) << "Mapping graph: " << vertexCount << " nodes, " << edgeCount
+                  << " edges";
+        LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
+                  << "ms to map the CSR snapshot.";
+        return true;
+    }
+
+    /**
+     * Sorts every row by edge value, ties in their order, so that the edges
+     * up to a given value come first in each row, e.g. the light edges of
+     * delta-stepping. The rows are then no longer sorted by destination,
+     * which `compress()` would undo.
+     */
+    void sortRowsByValue() {
+        assert(edges != NULL);
+        ThreadPool::get().parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+            std::vector<std::pair<EdgeValue, VertexId> > row;
+            for (VertexId v = begin; v < end; v++) {
+                EdgeId start = vertices[v];
+                EdgeId last = vertices[v + 1];
+                if (std::is_sorted(edgeValues + start, edgeValues + last)) continue;
+                row.resize(last - start);
+                for (EdgeId e = start; e < last; e++) {
+                    row[e - start] = std::make_pair(edgeValues[e], edges[e]);
+                }
+                std::stable_sort(row.begin(), row.end(),
+                    [](const std::pair<EdgeValue, VertexId> &a,
+                       const std::pair<EdgeValue, VertexId> &b) {
+                        return a.first < b.first;
+                    });
+                for (EdgeId e = start; e < last; e++) {
+                    edgeValues[e] = row[e - start].first;
+                    edges[e] = row[e - start].second;
+                }
+            }
+        });
+    }
+
+    /**
+     * Builds the gap-encoded adjacency (see compressedAdjacency.h), which
+     * is used by the engine instead of `edges` when it is present. Rows that
+     * are not sorted by destination are sorted first, together with their
+     * edge values. The vertex offsets are kept for the degrees and the edge
+     * values, which stay in their plain layout.
+     *
+     * @param dropEdges Whether to release `edges` afterwards, which leaves
+     * the compressed rows as the only copy of the topology.
+     * @return The number of bytes of the compressed rows
+     */
+    ByteOffset compress(bool dropEdges = true) {
+        if (edges == NULL) return compressedOffsets[vertexCount];
+
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        ThreadPool &pool = ThreadPool::get();
+        if (compressedOffsets == NULL) compressedOffsets = new ByteOffset[vertexCount + 1];
+        compressedOffsets[vertexCount] = 0;
+
+        // Sizes the rows first, then encodes each row at its prefix offset.
+        pool.parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+            for (VertexId v = begin; v < end; v++) {
+                sortRow(v);
+                compressedOffsets[v] = compressed::encodeRow(v, edges + vertices[v],
+                    vertices[v + 1] - vertices[v], NULL);
+            }
+        });
+        ByteOffset bytes = util::prefixSum(compressedOffsets, vertexCount + 1);
+
+        if (compressedEdges) delete[] compressedEdges;
+        compressedEdges = new unsigned char[bytes + COMPRESSED_PADDING]();
+        pool.parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+            for (VertexId v = begin; v < end; v++) {
+                compressed::encodeRow(v, edges + vertices[v],
+                    vertices[v + 1] - vertices[v],
+                    compressedEdges + compressedOffsets[v]);
+            }
+        });
+
+        if (dropEdges) {
+            // Edges of a snapshot live in the mapping, which stays mapped.
+            if (mapping.begin() == NULL) delete[] edges;
+            edges = NULL;
+        }
+
+        LOG(INFO) << "Compressed " << sizeof(VertexId) * edgeCount << " bytes of edges to "
+                  << bytes << " bytes ("
+                  << (edgeCount > 0 ? 8.0 * bytes / edgeCount : 0) << " bits per edge)";
+        LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
+                  << "ms to compress the graph.";
+        return bytes;
+    }
+
+    /**
+     * Builds the incoming edges of every vertex. The edges are reversed into
+     * tuples, which come out ordered by their new destination, so the radix
+     * sort only has to order them by their new source. Each in-row ends up
+     * sorted by source, whatever the scheduling.
+     */
+    void buildIncoming() {
+        if (inVertices != NULL) return;
+
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        typedef EdgeTuple<EdgeValue> Tuple;
+        ThreadPool &pool = ThreadPool::get();
+        Tuple *reversed = reinterpret_cast<Tuple *>(malloc(edgeCount * sizeof(Tuple)));
+        Tuple *buffer = reinterpret_cast<Tuple *>(malloc(edgeCount * sizeof(Tuple)));
+        pool.parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+            std::vector<VertexId> neighbors;
+            for (VertexId v = begin; v < end; v++) {
+                EdgeId start = vertices[v];
+                neighbors.resize(vertices[v + 1] - start);
+                getNeighbors(v, neighbors.data());
+                for (size_t i = 0; i < neighbors.size(); i++) {
+                    reversed[start + i] = Tuple(neighbors[i], v, edgeValues[start + i]);
+                }
+            }
+        });
+        if (vertexCount > 0) {
+            radixSortEdgeTuples(reversed, buffer, edgeCount, vertexCount - 1, true);
+        }
+
+        inVertices = new EdgeId[vertexCount + 1]();
+        inEdges = new VertexId[edgeCount];
+        inEdgeValues = new EdgeValue[edgeCount];
+        pool.parallelFor(edgeCount, [&](size_t begin, size_t end, int) {
+            for (EdgeId e = begin; e < end; e++) {
+                util::fetchAdd(&inVertices[reversed[e].srcId], EdgeId(1));
+                inEdges[e] = reversed[e].dstId;
+                inEdgeValues[e] = reversed[e].value;
+            }
+        }, 1 << 16);
+        util::prefixSum(inVertices, vertexCount + 1);
+        free(reversed);
+        free(buffer);
+
+        LOG(INFO) << "It took " << stopwatch.getElapsedMillis()
+                  << "ms to build the incoming edges.";
+    }
+
+    /**
+     * Renumbers the vertices by `ordering` and rebuilds the graph with the
+     * new ids through `fromEdgeTuples`. The vertex and edge values move along
+     * with their vertices and edges. Incoming edges are rebuilt if they were
+     * built before. `newIds` records the new id of every input vertex, which
+     * composes with earlier reorderings.
+     *
+     * @note The graph must not be compressed yet.
+     */
+    void reorder(const VertexOrdering &ordering) {
+        assert(edges != NULL);
+
+        Stopwatch stopwatch;
+        stopwatch.start();
+
+        std::vector<VertexId> permutation(vertexCount);
+        ordering.getNewIds(vertexCount, vertices, edges, permutation.data());
+        double orderMillis = stopwatch.getElapsedMillis();
+
+        typedef EdgeTuple<EdgeValue> Tuple;
+        ThreadPool &pool = ThreadPool::get();
+        Tuple *tuples = reinterpret_cast<Tuple *>(malloc(edgeCount * sizeof(Tuple)));
+        std::vector<VertexValue> values(vertexCount);
+        pool.parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+            for (VertexId v = begin; v < end; v++) {
+                values[permutation[v]] = vertexValues[v];
+                for (EdgeId e = vertices[v]; e < vertices[v + 1]; e++) {
+                    tuples[e] = Tuple(permutation[v], permutation[edges[e]], edgeValues[e]);
+                }
+            }
+        });
+
+        bool hadIncoming = (inVertices != NULL);
+        VertexId n = vertexCount;
+        EdgeId m = edgeCount;
+        releaseIndexes();
+        releaseBuffers();
+        fromEdgeTuples(n, tuples, m);
+        free(tuples);
+        std::copy(values.begin(), values.end(), vertexValues);
+        if (hadIncoming) buildIncoming();
+
+        if (newIds == NULL) {
+            newIds = new VertexId[vertexCount];
+            std::copy(permutation.begin(), permutation.end(), newIds);
+        } else {
+            for (VertexId v = 0; v < vertexCount; v++) {
+                newIds[v] = permutation[newIds[v]];
+            }
+        }
+
+        LOG(INFO) << "It took " << orderMillis << "ms to order the vertices, and "
+                  << stopwatch.getElapsedMillis() << "ms to rebuild the graph.";
+    }
+
+    /** Returns the id in the graph of the input vertex `v`. */
+    inline VertexId toNewId(VertexId v) const {
+        return newIds ? newIds[v] : v;
+    }
+
+    /**
+     * Writes the neighbors of `v` to `out`, whichever layout the graph is in.
+     */
+    void getNeighbors(VertexId v, VertexId *out) const {
+        EdgeId degree = vertices[v + 1] - vertices[v];
+        if (edges != NULL) {
+            std::copy(edges + vertices[v], edges + vertices[v + 1], out);
+            return;
+        }
+        const unsigned char *row = compressedEdges + compressedOffsets[v];
+        EdgeId blocks = compressed::numBlocks(degree);
+        for (EdgeId b = 0; b < blocks; b++) {
+            compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), v);
+            EdgeId k = b * COMPRESSED_BLOCK_SIZE;
+            EdgeId last = std::min(k + COMPRESSED_BLOCK_SIZE, degree);
+            out[k++] = decoder.dst;
+            for (; k < last; k++) {
+                decoder.next();
+                out[k] = decoder.dst;
+            }
+        }
     }
 
     /**
@@ -240,11 +848,13 @@ public:
      */
     void print(bool verbose = false) const {
         if (verbose) {
+            std::vector<VertexId> neighbors;
             for (VertexId v = 0; v < vertexCount; v++) {
-                printf("[%lld] ", v);
-                for (EdgeId e = vertices[v]; e < vertices[v + 1]; e++) {
-                    std::cout << " ->" << edges[e];
-                    printf(" ->%lld", edges[e]);
+                printf("[%llu] ", (unsigned long long) v);
+                neighbors.resize(vertices[v + 1] - vertices[v]);
+                getNeighbors(v, neighbors.data());
+                for (size_t i = 0; i < neighbors.size(); i++) {
+                    printf(" ->%llu", (unsigned long long) neighbors[i]);
                 }
                 printf("\n");
             }
@@ -284,6 +894,93 @@ public:
         }
     }
 
+private:
+    /** Keeps the snapshot mapped while the buffers point into it. */
+    MappedFile mapping;
+
+    /** Frees the compressed and incoming edges. */
+    void releaseIndexes() {
+        if (compressedEdges) delete[] compressedEdges;
+        if (compressedOffsets) delete[] compressedOffsets;
+        if (inVertices) delete[] inVertices;
+        if (inEdges) delete[] inEdges;
+        if (inEdgeValues) delete[] inEdgeValues;
+        compressedEdges = NULL;
+        compressedOffsets = NULL;
+        inVertices = NULL;
+        inEdges = NULL;
+        inEdgeValues = NULL;
+    }
+
+    /** Frees the CSR buffers, or unmaps the snapshot they point into. */
+    void releaseBuffers() {
+        if (mapping.begin() != NULL) {
+            mapping.unmap();
+        } else {
+            if (vertices) delete[] vertices;
+            if (edges) delete[] edges;
+            if (edgeValues) delete[] edgeValues;
+            if (vertexValues) delete[] vertexValues;
+        }
+        vertices = NULL;
+        edges = NULL;
+        edgeValues = NULL;
+        vertexValues = NULL;
+    }
+
+    /** Sorts the row of `v` by destination, unless it is sorted already. */
+    void sortRow(VertexId v) {
+        EdgeId start = vertices[v];
+        EdgeId last = vertices[v + 1];
+        if (std::is_sorted(edges + start, edges + last)) return;
+        std::vector<std::pair<VertexId, EdgeValue> > row(last - start);
+        for (EdgeId e = start; e < last; e++) {
+            row[e - start] = std::make_pair(edges[e], edgeValues[e]);
+        }
+        std::sort(row.begin(), row.end(),
+            [](const std::pair<VertexId, EdgeValue> &a,
+               const std::pair<VertexId, EdgeValue> &b) {
+                return a.first < b.first;
+            });
+        for (EdgeId e = start; e < last; e++) {
+            edges[e] = row[e - start].first;
+            edgeValues[e] = row[e - start].second;
+        }
+    }
+
+    static uint64_t alignUp(uint64_t offset) {
+        return (offset + CSR_GRAPH_ALIGNMENT - 1) / CSR_GRAPH_ALIGNMENT * CSR_GRAPH_ALIGNMENT;
+    }
+
+    /**
+     * Checks that a section of `count` elements of `elemBytes` at `offset` is
+     * aligned, starts at or after `end` and fits in the mapping, then moves
+     * `end` past it.
+     */
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t elemBytes,
+                     uint64_t &end) const {
+        uint64_t size = mapping.size();
+        if (offset % CSR_GRAPH_ALIGNMENT != 0 || offset < end || offset > size) {
+            return false;
+        }
+        if (count > (size - offset) / elemBytes) return false;
+        end = offset + count * elemBytes;
+        return true;
+    }
+
+    /**
+     * Pads the file with zeros up to `offset` and writes `bytes` from `buf`.
+     * `written` tracks the current size of the file.
+     */
+    static bool writeAt(FILE *file, uint64_t &written, uint64_t offset,
+                        const void *buf, uint64_t bytes) {
+        static const char zeros[CSR_GRAPH_ALIGNMENT] = {0};
+        if (fwrite(zeros, 1, offset - written, file) != offset - written) return false;
+        written = offset;
+        if (bytes > 0 && fwrite(buf, 1, bytes, file) != bytes) return false;
+        written += bytes;
+        return true;
+    }
 };
 
 
@@ -0,0 +1,80 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Chooses between top-down and bottom-up traversal steps.
+ */
+
+#ifndef DIRECTION_OPTIMIZER_H
+#define DIRECTION_OPTIMIZER_H
+
+#include <algorithm>
+
+#include "common.h"
+
+/**
+ * The heuristic of Beamer's direction-optimizing BFS. A top-down step costs
+ * the out-edges of the frontier (m_f), a bottom-up step at most the edges of
+ * the unvisited vertices (m_u), but it stops at the first parent found.
+ *
+ * The traversal goes bottom-up once m_f > m_u / alpha, and stays so while
+ * the frontier grows or still has more than n / beta vertices.
+ *
+ * One instance follows one traversal, since m_u is derived from the edges of
+ * the frontiers seen so far: every vertex is on the frontier once.
+ */
+class DirectionOptimizer {
+public:
+    DirectionOptimizer(VertexId _vertexCount, EdgeId _edgeCount,
+                       int _alpha = 15, int _beta = 18)
+        : vertexCount(_vertexCount), unexploredEdges(_edgeCount),
+          lastFrontierSize(0), alpha(_alpha), beta(_beta), pulling(false) {}
+
+    /**
+     * Returns whether the step expanding a frontier of `frontierSize`
+     * vertices and `frontierEdges` out-edges should go bottom-up.
+     */
+    bool bottomUp(VertexId frontierSize, EdgeId frontierEdges) {
+        if (pulling) {
+            pulling = frontierSize >= lastFrontierSize ||
+                      frontierSize > vertexCount / beta;
+        } else {
+            pulling = frontierEdges > unexploredEdges / alpha;
+        }
+        unexploredEdges -= std::min(frontierEdges, unexploredEdges);
+        lastFrontierSize = frontierSize;
+        return pulling;
+    }
+
+private:
+    VertexId vertexCount;
+    EdgeId   unexploredEdges;
+    VertexId lastFrontierSize;
+    int      alpha;
+    int      beta;
+    bool     pulling;
+};
+
+#endif  // DIRECTION_OPTIMIZER_H
@@ -34,6 +34,12 @@
 #ifndef EDGE_TUPLE_H
 #define EDGE_TUPLE_H
 
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+#include "threadPool.h"
+
 
 /**
  * COO representation. An edge is ternary tuple (`srcId`, `dstId`, `value`).
@@ -66,4 +72,94 @@ bool edgeTupleDstCompare(EdgeTuple a, EdgeTuple b) {
     return a.dstId < b.dstId;
 }
 
+template<typename EdgeTuple>
+bool edgeTupleSrcDstCompare(const EdgeTuple &a, const EdgeTuple &b) {
+    return a.srcId < b.srcId || (a.srcId == b.srcId && a.dstId < b.dstId);
+}
+
+/** Number of key bits sorted by each pass of the radix sort. */
+const int EDGE_TUPLE_RADIX_BITS = 8;
+const int EDGE_TUPLE_RADIX = 1 << EDGE_TUPLE_RADIX_BITS;
+
+/**
+ * Sorts the edge tuples by (`srcId`, `dstId`) with a parallel LSD radix sort.
+ *
+ * Every pass is a stable counting sort on one digit: each worker builds the
+ * digit histogram of a fixed block of tuples, the histograms are scanned in
+ * digit-major order, and each worker scatters its block to the positions it
+ * owns. The passes on `dstId` go first, so that the tuples end up clustered
+ * by `srcId` and ordered by `dstId` within a cluster. Only the digits needed
+ * for ids up to `maxId` are sorted, and a pass is skipped if all the tuples
+ * share the digit.
+ *
+ * Tuples that are ordered by `dstId` already, e.g. the reversed edges of
+ * a CSR graph, only need the passes on `srcId` (`dstSorted`).
+ *
+ * It runs in O(n) per pass and needs a second buffer of n tuples. The sorted
+ * tuples are returned in `tuples`, which may be swapped with `buffer`.
+ */
+template<typename EdgeValue>
+void radixSortEdgeTuples(EdgeTuple<EdgeValue> *&tuples,
+                         EdgeTuple<EdgeValue> *&buffer,
+                         size_t n,
+                         VertexId maxId,
+                         bool dstSorted = false)
+{
+    int keyBits = 0;
+    while (keyBits < static_cast<int>(sizeof(VertexId) * 8) &&
+            (static_cast<uint64_t>(maxId) >> keyBits) != 0) {
+        keyBits++;
+    }
+
+    ThreadPool &pool = ThreadPool::get();
+    size_t numBlocks = std::min<size_t>(pool.size(), n / 4096 + 1);
+    std::vector<size_t> offsets(numBlocks * EDGE_TUPLE_RADIX);
+
+    for (int pass = dstSorted ? 1 : 0; pass < 2; pass++) {
+        bool bySrc = (pass == 1);
+        for (int shift = 0; shift < keyBits; shift += EDGE_TUPLE_RADIX_BITS) {
+            EdgeTuple<EdgeValue> *in = tuples;
+            EdgeTuple<EdgeValue> *out = buffer;
+
+            // Histogram of each block.
+            pool.parallelFor(numBlocks, [&](size_t begin, size_t end, int) {
+                for (size_t b = begin; b < end; b++) {
+                    size_t *hist = &offsets[b * EDGE_TUPLE_RADIX];
+                    std::fill(hist, hist + EDGE_TUPLE_RADIX, 0);
+                    for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++) {
+                        VertexId key = bySrc ? in[i].srcId : in[i].dstId;
+                        hist[(key >> shift) & (EDGE_TUPLE_RADIX - 1)]++;
+                    }
+                }
+            }, 1);
+
+            // Digit-major scan keeps the blocks in order within a digit.
+            size_t sum = 0;
+            bool trivial = false;
+            for (int d = 0; d < EDGE_TUPLE_RADIX; d++) {
+                size_t digitCount = 0;
+                for (size_t b = 0; b < numBlocks; b++) {
+                    size_t count = offsets[b * EDGE_TUPLE_RADIX + d];
+                    offsets[b * EDGE_TUPLE_RADIX + d] = sum;
+                    sum += count;
+                    digitCount += count;
+                }
+                if (digitCount == n) trivial = true;
+            }
+            if (trivial) continue;
+
+            pool.parallelFor(numBlocks, [&](size_t begin, size_t end, int) {
+                for (size_t b = begin; b < end; b++) {
+                    size_t *pos = &offsets[b * EDGE_TUPLE_RADIX];
+                    for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++) {
+                        VertexId key = bySrc ? in[i].srcId : in[i].dstId;
+                        out[pos[(key >> shift) & (EDGE_TUPLE_RADIX - 1)]++] = in[i];
+                    }
+                }
+            }, 1);
+            std::swap(tuples, buffer);
+        }
+    }
+}
+
 #endif // EDGE_TUPLE_H
@@ -0,0 +1,410 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Synthetic graph generators.
+ */
+
+#ifndef GRAPH_GENERATOR_H
+#define GRAPH_GENERATOR_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "common.h"
+#include "edgeTuple.h"
+#include "logging.h"
+#include "threadPool.h"
+#include "utils.h"
+
+/**
+ * The generators emit edge tuples, which `CsrGraph::fromGenerator` turns into
+ * a graph. Random numbers come from a counter-based generator: the k-th
+ * number of edge `i` is a hash of (seed, i, k), so the output only depends
+ * on the seed, not on the number of threads or the scheduling.
+ *
+ * Edge values are drawn uniformly from [1, maxWeight], which is all 1s by
+ * default.
+ */
+namespace generator {
+
+/** The SplitMix64 finalizer, a bijective 64-bit mixing function. */
+inline unsigned long long mix(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/** A stream of random numbers for one edge. */
+class Random {
+public:
+    Random(unsigned long long seed, unsigned long long stream)
+        : state(mix(seed ^ mix(stream))) {}
+
+    inline unsigned long long next() {
+        state += 0x9e3779b97f4a7c15ULL;
+        return mix(state);
+    }
+
+    /** Uniform in [0, 1). */
+    inline double nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /** Uniform in [0, n). */
+    inline unsigned long long nextBelow(unsigned long long n) {
+        return next() % n;
+    }
+
+private:
+    unsigned long long state;
+};
+
+template<typename EdgeValue>
+inline EdgeValue weightOf(unsigned long long seed, EdgeId e, int maxWeight) {
+    if (maxWeight <= 1) return EdgeValue(1);
+    Random random(seed ^ 0x5bd1e995ULL, e);
+    return EdgeValue(1 + random.nextBelow(maxWeight));
+}
+
+/** Multiplies, giving the largest value instead of wrapping around. */
+inline unsigned long long saturatingMultiply(unsigned long long a,
+                                             unsigned long long b) {
+    if (a != 0 && b > ULLONG_MAX / a) return ULLONG_MAX;
+    return a * b;
+}
+
+/**
+ * Checks that `n` vertices can be numbered by `VertexId`, which keeps
+ * `VertexId(-1)` for no vertex.
+ */
+inline bool vertexCountFits(unsigned long long n) {
+    if (n < static_cast<unsigned long long>(static_cast<VertexId>(-1))) return true;
+    LOG(ERROR) << n << " vertices overflow the vertex ids, build with vertex_id_64=1";
+    return false;
+}
+
+/** Checks that `m` edge tuples can be indexed by `EdgeId`. */
+inline bool edgeCountFits(unsigned long long m) {
+    if (m < static_cast<unsigned long long>(static_cast<EdgeId>(-1))) return true;
+    LOG(ERROR) << m << " edges overflow the edge ids, build with edge_id_64=1";
+    return false;
+}
+
+/** Allocates `m` tuples, or returns NULL after logging it. */
+template<typename EdgeValue>
+inline EdgeTuple<EdgeValue> *allocateTuples(unsigned long long m) {
+    EdgeTuple<EdgeValue> *tuples = reinterpret_cast<EdgeTuple<EdgeValue> *>(
+        malloc(static_cast<size_t>(m) * sizeof(EdgeTuple<EdgeValue>)));
+    if (tuples == NULL) LOG(ERROR) << "Out of memory for " << m << " edges";
+    return tuples;
+}
+
+/**
+ * Generates `m` random edges with `edge(random, src, dst)`, each of which is
+ * stored in both directions.
+ *
+ * @return The tuples, or NULL if the 2 * `m` of them overflow `EdgeId`
+ */
+template<typename EdgeValue, typename EdgeF>
+EdgeTuple<EdgeValue> *randomEdges(unsigned long long m, unsigned long long seed,
+                                  int maxWeight, EdgeF edge) {
+    typedef EdgeTuple<EdgeValue> Tuple;
+    if (!edgeCountFits(saturatingMultiply(2, m))) return NULL;
+    Tuple *tuples = allocateTuples<EdgeValue>(2 * m);
+    if (tuples == NULL) return NULL;
+    ThreadPool::get().parallelFor(m, [&](size_t begin, size_t end, int) {
+        for (EdgeId i = begin; i < end; i++) {
+            Random random(seed, i);
+            VertexId src, dst;
+            edge(random, src, dst);
+            EdgeValue value = weightOf<EdgeValue>(seed, i, maxWeight);
+            tuples[2 * i] = Tuple(src, dst, value);
+            tuples[2 * i + 1] = Tuple(dst, src, value);
+        }
+    }, 1 << 14);
+    return tuples;
+}
+
+/**
+ * Generates a graph whose out-neighbors are given by `neighbors(v, emit)`,
+ * which calls `emit(dst)` for every out-neighbor of `v` by increasing id.
+ * The tuples come out sorted, so building the CSR needs no sort.
+ *
+ * @return The tuples, or NULL if their number overflows `EdgeId`
+ */
+template<typename EdgeValue, typename NeighborsF>
+EdgeTuple<EdgeValue> *structuredEdges(VertexId n, EdgeId &m, unsigned long long seed,
+                                      int maxWeight, const NeighborsF &neighbors) {
+    typedef EdgeTuple<EdgeValue> Tuple;
+    ThreadPool &pool = ThreadPool::get();
+
+    struct Counter {
+        EdgeId count;
+        inline void operator() (VertexId dst) { count++; }
+    };
+    struct Writer {
+        Tuple *tuples;
+        EdgeId pos;
+        VertexId src;
+        unsigned long long seed;
+        int maxWeight;
+        inline void operator() (VertexId dst) {
+            tuples[pos] = Tuple(src, dst, weightOf<EdgeValue>(seed, pos, maxWeight));
+            pos++;
+        }
+    };
+
+    // The degrees are also summed up per worker without wrapping around,
+    // to check the total before the prefix sum in `EdgeId`.
+    std::vector<EdgeId> offsets(n + 1);
+    std::vector<unsigned long long> totals(pool.size(), 0);
+    pool.parallelFor(n, [&](size_t begin, size_t end, int wid) {
+        for (VertexId v = begin; v < end; v++) {
+            Counter counter = {0};
+            neighbors(v, counter);
+            offsets[v] = counter.count;
+            totals[wid] += counter.count;
+        }
+    }, 1 << 14);
+    unsigned long long total = 0;
+    for (size_t w = 0; w < totals.size(); w++) total += totals[w];
+    if (!edgeCountFits(total)) return NULL;
+    offsets[n] = 0;
+    m = util::prefixSum(offsets.data(), n + 1);
+
+    Tuple *tuples = allocateTuples<EdgeValue>(m);
+    if (tuples == NULL) return NULL;
+    pool.parallelFor(n, [&](size_t begin, size_t end, int) {
+        for (VertexId v = begin; v < end; v++) {
+            Writer writer = {tuples, offsets[v], v, seed, maxWeight};
+            neighbors(v, writer);
+        }
+    }, 1 << 14);
+    return tuples;
+}
+
+/**
+ * R-MAT with the Graph500 parameters (A, B, C) = (0.57, 0.19, 0.19): each
+ * edge picks a quadrant of the adjacency matrix `scale` times. The vertex ids
+ * are scrambled by a bijection afterwards, so that the degree is unrelated to
+ * the id, like in the Graph500 generator.
+ */
+struct Rmat {
+    int scale;
+    unsigned long long seed;
+
+    /**
+     * Each level takes 16 random bits, compared against the cumulative
+     * probabilities in 1/65536 units, so a 64-bit number serves 4 levels.
+     */
+    inline void operator() (Random &random, VertexId &src, VertexId &dst) const {
+        const unsigned A = 37355, AB = 49807, ABC = 62259;  // 0.57, 0.76, 0.95
+        unsigned long long u = 0, v = 0, bits = 0;
+        for (int level = 0; level < scale; level++) {
+            if (level % 4 == 0) bits = random.next();
+            unsigned r = bits & 0xffff;
+            bits >>= 16;
+            u = (u << 1) | (r >= AB);
+            v = (v << 1) | ((r >= A && r < AB) || r >= ABC);
+        }
+        src = scramble(u);
+        dst = scramble(v);
+    }
+
+    /** Bijection on [0, 2^scale): odd multiply, bit reversal, odd multiply. */
+    inline VertexId scramble(unsigned long long x) const {
+        unsigned long long mask = (1ULL << scale) - 1;
+        x = (x * (mix(seed) | 1) + seed) & mask;
+        x = reverseBits(x) >> (64 - scale);
+        x = (x * (mix(seed + 1) | 1)) & mask;
+        return static_cast<VertexId>(x);
+    }
+
+    static inline unsigned long long reverseBits(unsigned long long x) {
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+        x = ((x >> 8) & 0x00ff00ff00ff00ffULL) | ((x & 0x00ff00ff00ff00ffULL) << 8);
+        x = ((x >> 16) & 0x0000ffff0000ffffULL) | ((x & 0x0000ffff0000ffffULL) << 16);
+        return (x >> 32) | (x << 32);
+    }
+};
+
+/** Erdős–Rényi G(n, m): both ends of every edge are uniform. */
+struct ErdosRenyi {
+    VertexId n;
+
+    inline void operator() (Random &random, VertexId &src, VertexId &dst) const {
+        src = random.nextBelow(n);
+        dst = random.nextBelow(n);
+    }
+};
+
+/** A w x h grid, where each vertex links to its 4 neighbors. */
+struct Grid2D {
+    VertexId w, h;
+
+    template<typename Emit>
+    inline void operator() (VertexId v, Emit &emit) const {
+        VertexId x = v % w, y = v / w;
+        if (y > 0) emit(v - w);
+        if (x > 0) emit(v - 1);
+        if (x + 1 < w) emit(v + 1);
+        if (y + 1 < h) emit(v + w);
+    }
+};
+
+/** An x * y * z grid, where each vertex links to its 6 neighbors. */
+struct Grid3D {
+    VertexId x, y, z;
+
+    template<typename Emit>
+    inline void operator() (VertexId v, Emit &emit) const {
+        VertexId plane = x * y;
+        VertexId i = v % x, j = (v / x) % y, k = v / plane;
+        if (k > 0) emit(v - plane);
+        if (j > 0) emit(v - x);
+        if (i > 0) emit(v - 1);
+        if (i + 1 < x) emit(v + 1);
+        if (j + 1 < y) emit(v + x);
+        if (k + 1 < z) emit(v + plane);
+    }
+};
+
+/** Vertex 0 linked to all the others. */
+struct Star {
+    VertexId n;
+
+    template<typename Emit>
+    inline void operator() (VertexId v, Emit &emit) const {
+        if (v > 0) {
+            emit(0);
+            return;
+        }
+        for (VertexId u = 1; u < n; u++) emit(u);
+    }
+};
+
+/** A path 0 - 1 - ... - (n - 1). */
+struct Chain {
+    VertexId n;
+
+    template<typename Emit>
+    inline void operator() (VertexId v, Emit &emit) const {
+        if (v > 0) emit(v - 1);
+        if (v + 1 < n) emit(v + 1);
+    }
+};
+
+/** Parses the fields of a spec separated by `:` as numbers. */
+inline std::vector<unsigned long long> parseFields(const char *spec) {
+    std::vector<unsigned long long> fields;
+    const char *p = strchr(spec, ':');
+    while (p != NULL) {
+        fields.push_back(strtoull(p + 1, NULL, 10));
+        p = strchr(p + 1, ':');
+    }
+    return fields;
+}
+
+inline bool hasKind(const char *spec, const char *kind) {
+    size_t len = strlen(kind);
+    return strncmp(spec, kind, len) == 0 && (spec[len] == ':' || spec[len] == '\0');
+}
+
+/**
+ * Generates the edge tuples of the graph described by `spec`:
+ * {{{
+ * rmat:<scale>[:<edge factor>]    2^scale vertices, edge factor 16 by default
+ * er:<n>:<m>                      n vertices, m random edges
+ * grid2d:<w>:<h>
+ * grid3d:<x>:<y>:<z>
+ * star:<n>
+ * chain:<n>
+ * }}}
+ * The edges of all graphs are stored in both directions, thus rmat and er
+ * have 2 * m tuples. The sizes are worked out in 64 bits, and rejected if
+ * they overflow the vertex or edge ids of the build.
+ *
+ * @return The tuples (to be freed by the caller), or NULL if the spec is
+ * invalid or too big
+ */
+template<typename EdgeValue>
+EdgeTuple<EdgeValue> *generateEdgeTuples(const char *spec, unsigned long long seed,
+                                         int maxWeight, VertexId &n, EdgeId &m) {
+    std::vector<unsigned long long> f = parseFields(spec);
+    if (hasKind(spec, "rmat") && f.size() >= 1 && f[0] >= 1) {
+        if (!vertexCountFits(f[0] >= 64 ? ULLONG_MAX : 1ULL << f[0])) return NULL;
+        int scale = static_cast<int>(f[0]);
+        Rmat rmat = {scale, seed};
+        n = static_cast<VertexId>(1ULL << scale);
+        unsigned long long edges = saturatingMultiply(f.size() >= 2 ? f[1] : 16, n);
+        m = 2 * edges;
+        return randomEdges<EdgeValue>(edges, seed, maxWeight, rmat);
+    }
+    if (hasKind(spec, "er") && f.size() == 2 && f[0] > 0) {
+        if (!vertexCountFits(f[0])) return NULL;
+        ErdosRenyi er = {static_cast<VertexId>(f[0])};
+        n = f[0];
+        m = 2 * f[1];
+        return randomEdges<EdgeValue>(f[1], seed, maxWeight, er);
+    }
+    if (hasKind(spec, "grid2d") && f.size() == 2 && f[0] > 0 && f[1] > 0) {
+        if (!vertexCountFits(saturatingMultiply(f[0], f[1]))) return NULL;
+        Grid2D grid = {static_cast<VertexId>(f[0]), static_cast<VertexId>(f[1])};
+        n = f[0] * f[1];
+        return structuredEdges<EdgeValue>(n, m, seed, maxWeight, grid);
+    }
+    if (hasKind(spec, "grid3d") && f.size() == 3 && f[0] > 0 && f[1] > 0 && f[2] > 0) {
+        if (!vertexCountFits(saturatingMultiply(saturatingMultiply(f[0], f[1]), f[2]))) {
+            return NULL;
+        }
+        Grid3D grid = {static_cast<VertexId>(f[0]), static_cast<VertexId>(f[1]),
+                       static_cast<VertexId>(f[2])};
+        n = f[0] * f[1] * f[2];
+        return structuredEdges<EdgeValue>(n, m, seed, maxWeight, grid);
+    }
+    if (hasKind(spec, "star") && f.size() == 1 && f[0] > 0) {
+        if (!vertexCountFits(f[0])) return NULL;
+        Star star = {static_cast<VertexId>(f[0])};
+        n = f[0];
+        return structuredEdges<EdgeValue>(n, m, seed, maxWeight, star);
+    }
+    if (hasKind(spec, "chain") && f.size() == 1 && f[0] > 0) {
+        if (!vertexCountFits(f[0])) return NULL;
+        Chain chain = {static_cast<VertexId>(f[0])};
+        n = f[0];
+        return structuredEdges<EdgeValue>(n, m, seed, maxWeight, chain);
+    }
+    return NULL;
+}
+
+}  // namespace generator
+
+#endif  // GRAPH_GENERATOR_H
@@ -35,10 +35,26 @@
 #define GRD_H
 
 #include "common.h"
+#include "threadPool.h"
+#include "utils.h"
+
+#ifndef OLIVE_HOST
+/** Sets the `length` elements of `elems` to `x`. */
+template<typename T>
+__global__
+void fillKernel(T *elems, size_t length, T x) {
+    for (size_t i = THREAD_INDEX; i < length; i += NUM_THREADS) {
+        elems[i] = x;
+    }
+}
+#endif
 
 /**
  * GPU-Resident Dataset (GRD) provides the utility for allocating data buffers
  * which can be transferred between CPU and GPU and accessed from both CPU and GPU.
+ *
+ * For the host backend there is only one buffer: `elemsDevice` aliases
+ * `elemsHost`, and the transfers become no-ops.
  */
 template<typename T>
 class GRD {
@@ -47,9 +63,11 @@ public:
     T      *elemsDevice;  /** Points to the GPU-allocated buffer */
     size_t  length;       /** The length of the buffer */
     int     deviceId;     /** The device GRD locates at */
+    bool    borrowed;     /** The host buffer belongs to someone else */
 
     /** List Initializer */
-    GRD(): elemsHost(NULL), elemsDevice(NULL), length(0), deviceId(-1) {}
+    GRD(): elemsHost(NULL), elemsDevice(NULL), length(0), deviceId(-1),
+        borrowed(false) {}
 
     /**
      * Overloads the subscript to access an element on host side.
@@ -79,28 +97,68 @@ public:
         deviceId = id;
         length = len;
         elemsHost = reinterpret_cast<T *>(malloc(len * sizeof(T)));
+#ifdef OLIVE_HOST
+        elemsDevice = elemsHost;
+#else
+        CUDA_CHECK(cudaSetDevice(deviceId));
+        CUDA_CHECK(cudaMalloc(reinterpret_cast<void **>(&elemsDevice),
+                              len * sizeof(T)));
+#endif
+    }
+
+    /**
+     * Use an existing buffer of length `len` as the host-resident buffer
+     * instead of allocating one, and allocate the device-resident buffer on
+     * device `id`. The host backend uses the buffer in place.
+     *
+     * @note The buffer is not freed by `del()` and must outlive the GRD.
+     */
+    inline void borrow(T *buffer, size_t len, int id = 0) {
+        assert(len > 0);
+        assert(id >= 0);
+        deviceId = id;
+        length = len;
+        borrowed = true;
+        elemsHost = buffer;
+#ifdef OLIVE_HOST
+        elemsDevice = elemsHost;
+#else
         CUDA_CHECK(cudaSetDevice(deviceId));
         CUDA_CHECK(cudaMalloc(reinterpret_cast<void **>(&elemsDevice),
                               len * sizeof(T)));
+#endif
     }
 
     /**
-     * Set all the elements to the value `x` on the device.
+     * Set all the elements to the value `x` on the device. The GPU backend
+     * fills the device buffer in place, and leaves the host one as it is.
      */
     void allTo(T x) {
-        for (size_t i = 0; i < length; i++) {
-            elemsHost[i] = x;
-        }
+#ifdef OLIVE_HOST
+        T *elems = elemsHost;
+        ThreadPool::get().parallelFor(length,
+        [elems, x](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++) {
+                elems[i] = x;
+            }
+        }, 1 << 16);
+#else
         CUDA_CHECK(cudaSetDevice(deviceId));
-        CUDA_CHECK(cudaMemcpy(elemsDevice, elemsHost,
-                              length * sizeof(T), cudaMemcpyDefault));
+        auto c = util::kernelConfig(length);
+        fillKernel<T> KERNEL_CONFIG(c)(elemsDevice, length, x);
+        util::synchronize();
+#endif
     }
 
     /**
      * Clear the every bytesto of the GRD.
      */
     void clear() {
+#ifdef OLIVE_HOST
+        memset(elemsHost, 0, sizeof(T) * length);
+#else
         CUDA_CHECK(cudaMemset(elemsDevice, 0, sizeof(T) * length));
+#endif
     }
 
     /**
@@ -108,18 +166,22 @@ public:
      */
     void set(size_t i, T x) {
         elemsHost[i] = x;
+#ifndef OLIVE_HOST
         CUDA_CHECK(cudaMemcpy(elemsDevice + i, elemsHost + i,
                               1 * sizeof(T), cudaMemcpyDefault));
+#endif
     }
 
     /**
      * Write-backs the dataset from GPU's on-board memory to host memory.
      */
     inline void persist() {
+#ifndef OLIVE_HOST
         if (length == 0) return;
         CUDA_CHECK(cudaSetDevice(deviceId));
         CUDA_CHECK(cudaMemcpy(elemsHost, elemsDevice,
                               length * sizeof(T), cudaMemcpyDefault));
+#endif
     }
 
 
@@ -127,14 +189,14 @@ public:
      * Call the user defined print() function to print the GRD.
      */
     inline void print() {
-        for (int i = 0; i < length; i++) {
+        for (size_t i = 0; i < length; i++) {
             elemsHost[i].print();
         }
     }
 
     inline void peek() {
         persist();
-        for (int i = 0; i < length; i++) {
+        for (size_t i = 0; i < length; i++) {
             std::cout << elemsHost[i] << " ";
         }
         printf("\n");
@@ -144,10 +206,12 @@ public:
      * Caches the dataset in GPU's on-board memory.
      */
     inline void cache() {
+#ifndef OLIVE_HOST
         if (length == 0) return;
         CUDA_CHECK(cudaSetDevice(deviceId));
         CUDA_CHECK(cudaMemcpy(elemsDevice, elemsHost,
                               length * sizeof(T), cudaMemcpyDefault));
+#endif
     }
 
     /**
@@ -155,12 +219,14 @@ public:
      */
     inline void del() {
         if (deviceId < 0) return;
-        if (elemsHost)
+        if (elemsHost && !borrowed)
             free(elemsHost);
+#ifndef OLIVE_HOST
         if (elemsDevice) {
             CUDA_CHECK(cudaSetDevice(deviceId));
             CUDA_CHECK(cudaFree(elemsDevice));
         }
+#endif
     }
 
     // /** Destructor **/
@@ -0,0 +1,114 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Read-only memory-mapped file.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "logging.h"
+
+/**
+ * Maps a whole file into the address space for reading. The mapping lives
+ * until `unmap()` is called.
+ *
+ * A private mapping can be made writable. Pages are then copied on the first
+ * write, and the file itself is never modified.
+ */
+class MappedFile {
+public:
+    MappedFile() : data(NULL), length(0) {}
+
+    /**
+     * Maps the file at `path`.
+     * @param  writable  Whether the pages may be modified (copy-on-write)
+     * @return  False if the file can not be opened or mapped
+     */
+    bool map(const char *path, bool writable = false) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            LOG(ERROR) << "Can not open file: " << path;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            LOG(ERROR) << "Can not stat file: " << path;
+            close(fd);
+            return false;
+        }
+        length = st.st_size;
+        if (length == 0) {
+            close(fd);
+            return true;
+        }
+        int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void *p = mmap(NULL, length, prot, MAP_PRIVATE, fd, 0);
+        close(fd);  // The mapping keeps its own reference to the file
+        if (p == MAP_FAILED) {
+            LOG(ERROR) << "Can not map file: " << path;
+            length = 0;
+            return false;
+        }
+        data = static_cast<const char *>(p);
+        return true;
+    }
+
+    /** Tells the kernel that the mapping will be read front to back. */
+    inline void adviseSequential() const {
+        if (data) madvise(const_cast<char *>(data), length, MADV_SEQUENTIAL);
+    }
+
+    inline const char *begin() const {
+        return data;
+    }
+
+    inline const char *end() const {
+        return data + length;
+    }
+
+    inline size_t size() const {
+        return length;
+    }
+
+    void unmap() {
+        if (data) munmap(const_cast<char *>(data), length);
+        data = NULL;
+        length = 0;
+    }
+
+private:
+    const char *data;
+    size_t      length;
+};
+
+#endif  // MAPPED_FILE_H
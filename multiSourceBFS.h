@@ -0,0 +1,288 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Multi-source BFS: up to 64 traversals per word of the vertex state run in
+ * the same level-synchronous sweep, so that each adjacency list is read once
+ * per level for all of them instead of once per source.
+ */
+
+#ifndef MULTI_SOURCE_BFS_H
+#define MULTI_SOURCE_BFS_H
+
+#include <vector>
+
+#include "oliver.h"
+
+/** A set of traversals, one bit each, in `Words` machine words. */
+template<int Words>
+struct SourceSet {
+    Word bits[Words];
+};
+
+template<int Words>
+struct MSBFS_Vertex {
+    SourceSet<Words> seen;      /** The traversals that have reached it */
+    SourceSet<Words> frontier;  /** Those that reached it at the last level */
+};
+
+template<int Words>
+struct MSBFS_edge_F {
+    __device__
+    inline SourceSet<Words> gather(MSBFS_Vertex<Words> src, EdgeId outdegree,
+                                   Dump_Edge edge) {
+        return src.frontier;
+    }
+
+    __device__
+    inline void reduce(SourceSet<Words> &accumulator, SourceSet<Words> accum) {
+        for (int i = 0; i < Words; i++) {
+            bitmap::setMask(&accumulator.bits[i], accum.bits[i]);
+        }
+    }
+};  // edgeFilter
+
+template<int Words>
+struct MSBFS_vertex_F {
+    /** Whether a traversal reaches the vertex for the first time. */
+    __device__
+    inline bool cond(MSBFS_Vertex<Words> v, SourceSet<Words> accum) {
+        for (int i = 0; i < Words; i++) {
+            if (accum.bits[i] & ~v.seen.bits[i]) return true;
+        }
+        return false;
+    }
+
+    __device__
+    inline void update(MSBFS_Vertex<Words> &v, SourceSet<Words> accum) {
+        for (int i = 0; i < Words; i++) {
+            v.frontier.bits[i] = accum.bits[i] & ~v.seen.bits[i];
+            v.seen.bits[i] |= v.frontier.bits[i];
+        }
+    }
+};  // vertexFilter
+
+template<int Words>
+struct MSBFS_init_F {
+    __device__
+    inline void operator() (MSBFS_Vertex<Words> &v, SourceSet<Words> accum) {
+        for (int i = 0; i < Words; i++) {
+            v.seen.bits[i] = 0;
+            v.frontier.bits[i] = 0;
+        }
+    }
+};  // vertexMap
+
+template<int Words>
+struct MSBFS_seeded_F {
+    __device__
+    inline bool cond(MSBFS_Vertex<Words> v, SourceSet<Words> accum) {
+        for (int i = 0; i < Words; i++) {
+            if (v.frontier.bits[i]) return true;
+        }
+        return false;
+    }
+
+    __device__
+    inline void update(MSBFS_Vertex<Words> &v, SourceSet<Words> accum) {}
+};  // vertexFilter
+
+/** What the traversal from one source has found. */
+struct BFSSummary {
+    VertexId reached;       /** Vertices reached, the source included */
+    uint64_t distanceSum;   /** Sum of their levels, for closeness */
+    int      eccentricity;  /** The deepest level, for the radius */
+};
+
+/**
+ * Runs batches of BFS from many sources over the same graph, for closeness,
+ * radius estimation or reachability queries. The vertex state is a bit per
+ * traversal: the traversals that have seen the vertex, and those that
+ * reached it at the last level. A level ORs the latter along the out-edges
+ * of the vertices where any traversal is, so one expansion serves up to
+ * `MAX_SOURCES` of them.
+ *
+ * The levels are not kept per vertex. The frontier of every level is folded
+ * on the host into a `BFSSummary` per source, and optionally into a full
+ * table of levels.
+ */
+template<int Words = 1>
+class MultiSourceBFS {
+public:
+    static const int MAX_SOURCES = Words * bitmap::WORD_BITS;
+
+    /** @note The graph must outlive the object, like for `readGraph`. */
+    template<typename GraphVertexValue, typename GraphEdgeValue>
+    explicit MultiSourceBFS(const CsrGraph<GraphVertexValue, GraphEdgeValue> &graph) :
+        ol(noSources()), n(graph.vertexCount), newIds(graph.newIds),
+        all(graph.vertexCount, true), frontier(graph.vertexCount),
+        edgeFrontier(graph.vertexCount, false)
+    {
+        ol.readGraph(graph);
+        if (newIds != NULL) {
+            oldIds.resize(n);
+            for (VertexId v = 0; v < n; v++) oldIds[newIds[v]] = v;
+        }
+    }
+
+    /**
+     * Runs a BFS from each of `sources[0..count)`, in input ids, at once.
+     * A source may be given more than once.
+     *
+     * @param summaries  Gets the summary of each source
+     * @param levels     If not NULL, `levels[i * n + v]` gets the level of
+     *                   (input) vertex `v` from `sources[i]`, or -1 if it is
+     *                   not reached. It holds `count * n` levels.
+     * @return The number of levels expanded, i.e. the largest eccentricity.
+     */
+    int run(const VertexId *sources, int count, BFSSummary *summaries,
+            int *levels = NULL) {
+        assert(count > 0 && count <= MAX_SOURCES);
+        for (int i = 0; i < count; i++) {
+            summaries[i].reached = 0;
+            summaries[i].distanceSum = 0;
+            summaries[i].eccentricity = 0;
+        }
+        if (levels != NULL) {
+            std::fill(levels, levels + static_cast<size_t>(count) * n, -1);
+        }
+
+        // Vertices given as several sources start with all their bits.
+        ol.template vertexMap<MSBFS_init_F<Words> >(all, MSBFS_init_F<Words>());
+        MSBFS_Vertex<Words> cleared;
+        cleared.seen = cleared.frontier = noSources();
+        std::vector<VertexId> seeds;
+        std::vector<MSBFS_Vertex<Words> > seedValues;
+        for (int i = 0; i < count; i++) {
+            VertexId v = newIds ? newIds[sources[i]] : sources[i];
+            size_t s = std::find(seeds.begin(), seeds.end(), v) - seeds.begin();
+            if (s == seeds.size()) {
+                seeds.push_back(v);
+                seedValues.push_back(cleared);
+            }
+            bitmap::set(seedValues[s].seen.bits, i);
+            bitmap::set(seedValues[s].frontier.bits, i);
+        }
+        for (size_t s = 0; s < seeds.size(); s++) {
+            ol.setVertexValue(seeds[s], seedValues[s]);
+        }
+        ol.template vertexFilter<MSBFS_seeded_F<Words>, false>(
+            frontier, all, MSBFS_seeded_F<Words>());
+
+        int level = 0;
+        while (true) {
+            fold(level, count, summaries, levels);
+            ol.template edgeFilter<MSBFS_edge_F<Words> >(
+                edgeFrontier, frontier, MSBFS_edge_F<Words>());
+            ol.template vertexFilter<MSBFS_vertex_F<Words>, false>(
+                frontier, edgeFrontier, MSBFS_vertex_F<Words>());
+            if (frontier.size() == 0) break;
+            level++;
+        }
+        return level;
+    }
+
+    /**
+     * Runs BFS from all of `sources`, in batches of `MAX_SOURCES`, and
+     * returns their summaries in the same order.
+     */
+    void run(const std::vector<VertexId> &sources,
+             std::vector<BFSSummary> &summaries) {
+        summaries.resize(sources.size());
+        for (size_t i = 0; i < sources.size(); i += MAX_SOURCES) {
+            int count = std::min(static_cast<size_t>(MAX_SOURCES), sources.size() - i);
+            run(&sources[i], count, &summaries[i]);
+        }
+    }
+
+    ~MultiSourceBFS() {
+        all.del();
+        frontier.del();
+        edgeFrontier.del();
+    }
+
+private:
+    static SourceSet<Words> noSources() {
+        SourceSet<Words> s;
+        for (int i = 0; i < Words; i++) s.bits[i] = 0;
+        return s;
+    }
+
+    /**
+     * Adds the vertices of the frontier, which is at `level` from the
+     * traversals of their frontier bits, to the summaries and levels. The
+     * workers count into their own row of `reachedAt`.
+     */
+    void fold(int level, int count, BFSSummary *summaries, int *levels) {
+        VertexId size = frontier.size();
+        frontier.workqueue.persist();
+        const VertexId *queue = frontier.workqueue.elemsHost;
+        const MSBFS_Vertex<Words> *values = ol.getVertexValues();
+        int workers = ThreadPool::get().size();
+        reachedAt.assign(static_cast<size_t>(workers) * MAX_SOURCES, 0);
+
+        ThreadPool::get().parallelFor(size, [&](size_t begin, size_t end, int wid) {
+            VertexId *local = &reachedAt[static_cast<size_t>(wid) * MAX_SOURCES];
+            for (size_t pos = begin; pos < end; pos++) {
+                VertexId v = queue[pos];
+                VertexId input = newIds ? oldIds[v] : v;
+                for (int w = 0; w < Words; w++) {
+                    Word bits = values[v].frontier.bits[w];
+                    while (bits) {
+                        int s = w * bitmap::WORD_BITS + bitmap::lowestBit(bits);
+                        bits &= bits - 1;
+                        local[s]++;
+                        if (levels) levels[static_cast<size_t>(s) * n + input] = level;
+                    }
+                }
+            }
+        }, FOLD_GRAIN);
+
+        for (int s = 0; s < count; s++) {
+            VertexId reached = 0;
+            for (int w = 0; w < workers; w++) {
+                reached += reachedAt[static_cast<size_t>(w) * MAX_SOURCES + s];
+            }
+            if (reached == 0) continue;
+            summaries[s].reached += reached;
+            summaries[s].distanceSum += static_cast<uint64_t>(reached) * level;
+            summaries[s].eccentricity = level;
+        }
+    }
+
+    /** Frontier vertices a worker folds at least. */
+    static const size_t FOLD_GRAIN = 1024;
+
+    Oliver<MSBFS_Vertex<Words>, Dump_Edge, SourceSet<Words> > ol;
+    VertexId              n;
+    const VertexId       *newIds;
+    std::vector<VertexId> oldIds;     /** The input id of every vertex */
+    VertexSubset          all;
+    VertexSubset          frontier;
+    VertexSubset          edgeFrontier;
+    std::vector<VertexId> reachedAt;  /** Per worker and source, by `fold` */
+};
+
+#endif  // MULTI_SOURCE_BFS_H
@@ -188,9 +188,10 @@ public:
         for (int i = 0; i < partitions.size(); i++) {
             partitions[i].workset.persist();
             partitions[i].accumulators.persist();
-            for (int j = 0; j < partitions[i].workset.length; j++) {
+            for (int j = 0; j < partitions[i].vertexCount; j++) {
                 printf("%d: %d\t%f\n", partitions[i].globalIds[j],
-                       partitions[i].workset[j], partitions[i].accumulators[j]);
+                       bitmap::get(partitions[i].workset.elemsHost, j),
+                       partitions[i].accumulators[j]);
             }
         }
 
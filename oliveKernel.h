@@ -35,6 +35,7 @@
 #define OLIVE_KERNEL_H
 
 #include "common.h"
+#include "bitmap.h"
 
 
 /**
@@ -52,7 +53,7 @@ void edgeGatherKernel(
     const Vertex   *edges,
     VertexValue    *vertexValues,
     AccumValue     *accumulators,
-    int            *activties,
+    Word           *activties,
     MessageBox< VertexMessage<AccumValue> > *outboxes,
     F f)
 {
@@ -72,7 +73,7 @@ void edgeGatherKernel(
         if (dstPid == thisPid) {  // In this partition
             VertexId dstId = edges[edge].localId;
             f.reduce(accumulators[dstId], accum);
-            activties[dstId] = 1;
+            bitmap::set(activties, dstId);
         } else {  // In remote partition
             VertexMessage<AccumValue> msg;
             msg.receiverId = edges[edge].localId;
@@ -94,7 +95,7 @@ __global__
 void edgeScatterKernel(
     const MessageBox< VertexMessage<AccumValue> > &inbox,
     AccumValue *accumulators,
-    int *activties,
+    Word *activties,
     F f)
 {
     int tid = THREAD_INDEX;
@@ -102,7 +103,7 @@ void edgeScatterKernel(
     VertexId dstId = inbox.buffer[tid].receiverId;
     AccumValue accum = inbox.buffer[tid].value;
     f.reduce(accumulators[dstId], accum);
-    activties[dstId] = 1;
+    bitmap::set(activties, dstId);
 }
 
 
@@ -118,7 +119,7 @@ template<typename VertexValue,
          typename F>
 __global__
 void vertexMapKernel(
-    int         *activties,
+    Word        *activties,
     int          verticeCount,
     VertexValue *vertexValues,
     AccumValue  *accumulators,
@@ -129,19 +130,16 @@ void vertexMapKernel(
     int tid = THREAD_INDEX;
     if (tid >= verticeCount) return;
 
-    if (activties[tid] == 0) return;
-
-    // Deactivate anyway, since we only want the vertex with changed
-    // accumulator to be activated in the vertex phase.
-    activties[tid] = 0;  
+    if (!bitmap::get(activties, tid)) return;
 
+    // Only the vertex with changed accumulator stays activated in the
+    // vertex phase. Its bit shares a word with others, hence the atomics.
     if (f.cond(vertexValues[tid])) {
         f.update(vertexValues[tid], accumulators[tid]);
-
-        // if the local state is modified,  activate it
-        activties[tid] = 1;        
         VertexId pos = atomicAdd(workqueueSize, 1);
         workqueue[pos] = tid;
+    } else {
+        bitmap::unset(activties, tid);
     }
 }
 
@@ -150,7 +148,7 @@ template<typename VertexValue,
          typename F>
 __global__
 void vertexFilterKernel(
-    int         *activties,
+    Word        *activties,
     int          verticeCount,
     VertexValue *vertexValues,
     VertexId    *workqueue,
@@ -161,7 +159,7 @@ void vertexFilterKernel(
     if (tid >= verticeCount) return;
     if (f.cond(vertexValues[tid])) {
         f.update(vertexValues[tid]);
-        activties[tid] = 1;
+        bitmap::set(activties, tid);
         VertexId pos = atomicAdd(workqueueSize, 1);
         workqueue[pos] = tid;
     }
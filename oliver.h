@@ -23,7 +23,8 @@
  */
 
 /**
- * The single GPU version of Olive
+ * The single GPU version of Olive. Built without nvcc, the same operators run
+ * on the multithreaded host backend.
  *
  * Author: Yichao Cheng (onesuperclark@gmail.com)
  * Created on: 2015-02-05
@@ -33,6 +34,12 @@
 #ifndef OLIVER_H
 #define OLIVER_H
 
+#include <limits.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+
 #include "common.h"
 #include "csrGraph.h"
 #include "logging.h"
@@ -40,8 +47,56 @@
 #include "utils.h"
 #include "commandLine.h"
 #include "grd.h"
-#include "vertexSubset.h"
+#ifdef OLIVE_HOST
+#include "oliverHost.h"
+#else
 #include "oliverKernel.h"
+#endif
+#include "vertexSubset.h"
+#include "directionOptimizer.h"
+
+/**
+ * A step expanding a frontier of n_f vertices and m_f out-edges goes dense,
+ * i.e. flags its output instead of queueing it, once n_f + m_f exceeds
+ * `edgeCount / DENSE_FRONTIER_DIVISOR`, like in Ligra.
+ */
+const EdgeId DENSE_FRONTIER_DIVISOR = 20;
+
+/**
+ * The `GroupSize` of `edgeFilter` that splits the edges of the frontier
+ * evenly between the threads, instead of giving each vertex to a group.
+ */
+const int LOAD_BALANCED = 0;
+
+/**
+ * The default `GroupSize` of `edgeFilter`, which picks one of the others at
+ * every step from the degrees of the frontier.
+ */
+const int ADAPTIVE = -1;
+
+/** Number of frontier vertices whose degree `ADAPTIVE` looks at. */
+const VertexId ADAPTIVE_SAMPLES = 256;
+
+/**
+ * `ADAPTIVE` balances the load once the biggest sampled degree exceeds the
+ * mean by this factor, i.e. once a group would wait on a hub.
+ */
+const EdgeId ADAPTIVE_SKEW = 32;
+
+/**
+ * A destination is a hub, whose accumulator the push operators privatize,
+ * if its in-degree is at least `HUB_MIN_IN_DEGREE` and `HUB_SKEW` times the
+ * mean. At most `MAX_HUBS` of the highest in-degree are kept.
+ */
+const EdgeId HUB_MIN_IN_DEGREE = 256;
+const EdgeId HUB_SKEW = 32;
+
+/**
+ * The part of every row the top-down operators scan: all of it, or the edges
+ * before or from the split of the row, see `Oliver::readRowSplits`. E.g. the
+ * light and the heavy edges of rows sorted by weight.
+ */
+enum RowSlice { WHOLE_ROWS, BEFORE_SPLIT, FROM_SPLIT };
 
 template<typename VertexValue,
          typename EdgeValue,
@@ -49,58 +104,175 @@ template<typename VertexValue,
 class Oliver {
 public:
     /**
-     * The edgeFilter function invokes the corresponding subroutine
-     * according to the representation of the source vertex subset and
-     * produces a sparse vertex subset as output.
+     * The edgeFilter function expands the frontier `src` along the outgoing
+     * edges and collects the destinations in `dst`.
+     *
+     * Either representation of `src` is accepted; a sparse one is turned
+     * into a queue first. The representation of `dst` follows the density of
+     * the step: small frontiers queue their destinations, which keeps the
+     * step proportional to the frontier, and large ones only flag them,
+     * which needs no atomics.
+     *
+     * Each vertex of the frontier is expanded by a group of `GroupSize`
+     * threads, or with `LOAD_BALANCED` its edges go to whichever threads
+     * the even split of all the edges of the frontier assigns them. By
+     * default (`ADAPTIVE`) the engine chooses at every step, see
+     * `chooseGroupSize`, and logs its choice at level DEBUG1.
      */
-    template<typename F, int GroupSize>
-    void edgeFilter(VertexSubset &dst, const VertexSubset &src, F f) {
+    template<typename F, int GroupSize = ADAPTIVE>
+    void edgeFilter(VertexSubset &dst, VertexSubset &src, F f) {
+        src.toQueue();
+        topDown<F, GroupSize>(dst, src, f, frontierEdges(src), WHOLE_ROWS);
+    }
 
-        assert(!dst.isDense);
-        assert(src.isDense);
+    /**
+     * `edgeFilter` along a slice of the rows of `src` only, which costs only
+     * the edges of the slice. `f.gather` sees the number of the edges in the
+     * slice as the out-degree.
+     *
+     * Requires the splits of the rows, and a graph that is not compressed.
+     */
+    template<typename F, int GroupSize = ADAPTIVE>
+    void edgeFilter(VertexSubset &dst, VertexSubset &src, F f, RowSlice slice) {
+        src.toQueue();
+        topDown<F, GroupSize>(dst, src, f, frontierEdges(src, slice), slice);
+    }
 
-        // Clear the destination subset before generating it.
-        dst.clear();
+    /**
+     * The bottom-up counterpart of `edgeFilter`. Instead of the frontier
+     * `src` pushing along its out-edges, every vertex for which
+     * `f.cond(value)` holds looks through its in-edges for a source in `src`.
+     * It gathers from the first one only, so `f.reduce` should not care
+     * which of its parents it sees, like in BFS. `dst` comes out sparse.
+     *
+     * Requires the incoming edges, see `readGraph`.
+     */
+    template<typename F>
+    void edgeFilterPull(VertexSubset &dst, const VertexSubset &src, F f) {
 
-        // Reset the accumulators before the gather phase starts
-        accumulators.allTo(defaultAccumValue);
-        {
-            auto c = util::kernelConfig(src.size() * GroupSize);
+        assert(hasIncoming);
 
-            edgeFilterKernel<VertexValue, AccumValue, EdgeValue, F, GroupSize>
-            <<< c.first, c.second>>>(
-                src.workqueue.elemsDevice,
-                src.qSizeDevice,
-                srcVertices.elemsDevice,
-                outgoingEdges.elemsDevice,
-                vertexValues.elemsDevice,
-                accumulators.elemsDevice,
-                edgeValues.elemsDevice,
-                dst.workset.elemsDevice,
-                f);
+        dst.clearAsFlags();
+        resetAccumulators();
+        dirtyAll = true;
+
+        auto c = util::kernelConfig(vertexCount);
+        edgeFilterPullKernel<VertexValue, AccumValue, EdgeValue, F>
+        KERNEL_CONFIG(c)(
+            flagsOf(src),
+            vertexCount,
+            srcVertices.elemsDevice,
+            dstVertices.elemsDevice,
+            incomingEdges.elemsDevice,
+            vertexValues.elemsDevice,
+            accumulators.elemsDevice,
+            incomingEdgeValues.elemsDevice,
+            dst.workset.elemsDevice,
+            f);
+        util::synchronize();
+    }
+
+    /**
+     * Direction-optimizing `edgeFilter`: each step goes either top-down
+     * (`edgeFilter`) or bottom-up (`edgeFilterPull`), as `direction` chooses
+     * from the size and the out-edges of the frontier. Without the incoming
+     * edges every step goes top-down.
+     */
+    template<typename F, int GroupSize = ADAPTIVE>
+    void edgeFilter(VertexSubset &dst, VertexSubset &src, F f,
+                    DirectionOptimizer &direction) {
+        src.toQueue();
+        EdgeId edges = frontierEdges(src);
+        VertexId size = src.size();
+        if (direction.bottomUp(size, edges) && hasIncoming) {
+            double start = getTimeMillis();
+            edgeFilterPull<F>(dst, src, f);
+            LOG(DEBUG1) << "edgeFilter: " << size << " vertices, " << edges
+                        << " edges, bottom-up, " << getTimeMillis() - start << "ms";
+        } else {
+            topDown<F, GroupSize>(dst, src, f, edges, WHOLE_ROWS);
         }
-        CUDA_CHECK(cudaThreadSynchronize());
     }
 
+    /**
+     * Chooses the `GroupSize` of a top-down step from the degrees of the
+     * vertices sampled in queue `src`: `LOAD_BALANCED` if some hub stands
+     * out, otherwise the power of two closest to the mean degree, up to 32
+     * (a warp), so that the lanes of a group have an edge each.
+     */
+    int chooseGroupSize(const VertexSubset &src, EdgeId frontierEdges,
+                        RowSlice slice = WHOLE_ROWS) {
+        VertexId size = src.size();
+        if (size == 0) return 1;
+        VertexId count = std::min(size, ADAPTIVE_SAMPLES);
+        if (degreeSamples.capacity() == 0) degreeSamples.reserve(ADAPTIVE_SAMPLES);
+        auto c = util::kernelConfig(count);
+        sampleDegreesKernel KERNEL_CONFIG(c)(
+            src.workqueue.elemsDevice,
+            src.qSizeDevice,
+            rowStarts(slice),
+            rowEnds(slice),
+            degreeSamples.elemsDevice,
+            count);
+        util::synchronize();
+        degreeSamples.persist();
+
+        EdgeId mean = std::max<EdgeId>(frontierEdges / size, 1);
+        EdgeId biggest = *std::max_element(degreeSamples.elemsHost,
+                                           degreeSamples.elemsHost + count);
+        if (biggest > ADAPTIVE_SKEW * mean) return LOAD_BALANCED;
+        int group = 1;
+        while (group < 32 && 2 * group <= mean + mean / 2) group *= 2;
+        return group;
+    }
+
+    /**
+     * Returns the number of the out-edges of the vertices in queue `src`, or
+     * of those in a `slice` of their rows.
+     */
+    EdgeId frontierEdges(const VertexSubset &src, RowSlice slice = WHOLE_ROWS) {
+        assert(src.isDense);
+        if (edgeTotal.capacity() == 0) edgeTotal.reserve(1);
+        edgeTotal.set(0, 0);
+        auto c = util::kernelConfig(src.size());
+        frontierEdgesKernel KERNEL_CONFIG(c)(
+            src.workqueue.elemsDevice,
+            src.qSizeDevice,
+            rowStarts(slice),
+            rowEnds(slice),
+            edgeTotal.elemsDevice);
+        util::synchronize();
+        edgeTotal.persist();
+        return edgeTotal[0];
+    }
 
     /**
      * vertexFilter is used to update the local vertex state.
      *
-     * It takes as input a sparse vertex subset and produces either a sparse
-     * vertex subset or a dense one as output.
+     * It takes as input a vertex subset in either representation, and
+     * produces a dense one as output. A dense input costs only its size.
      */
     template<typename F, bool UseScan>
     void vertexFilter(VertexSubset &dst, const VertexSubset &src, F f) {
         
-        assert(!src.isDense);
-        assert(dst.isDense);
         // Clear the destination subset before generating it.
-        dst.clear();
+        dst.clearAsQueue();
 
-        {
+        if (src.isDense) {
+            auto c = util::kernelConfig(src.size());
+            vertexFilterQueueKernel<VertexValue, AccumValue, F>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                dst.workqueue.elemsDevice,
+                dst.qSizeDevice,
+                f);
+        } else {
             auto c = util::kernelConfig(src.capacity());
             vertexFilterKernel<VertexValue, AccumValue, F, UseScan>
-            <<< c.first, c.second>>>(
+            KERNEL_CONFIG(c)(
                 src.workset.elemsDevice,
                 src.capacity(),
                 vertexValues.elemsDevice,
@@ -109,7 +281,7 @@ public:
                 dst.qSizeDevice,
                 f);
         } 
-        CUDA_CHECK(cudaThreadSynchronize());
+        util::synchronize();
     }
 
 
@@ -121,23 +293,60 @@ public:
     template<typename F>
     void edgeMap(const VertexSubset &src, F f) {
 
-        assert(!src.isDense);
-
         // Reset the accumulators before the gather phase starts
-        accumulators.allTo(defaultAccumValue);
-        
+        resetAccumulators();
+        dirtyAll = true;
+
         auto c = util::kernelConfig(src.capacity());
-        edgeMapKernel<VertexValue, AccumValue, EdgeValue, F>
-        <<< c.first, c.second>>>(
-            src.workset.elemsDevice,
-            src.capacity(),
-            srcVertices.elemsDevice,
-            outgoingEdges.elemsDevice,
-            vertexValues.elemsDevice,
-            accumulators.elemsDevice,
-            edgeValues.elemsDevice,
-            f);
-        CUDA_CHECK(cudaThreadSynchronize());
+        if (compressed) {
+            edgeMapCompressedKernel<VertexValue, AccumValue, EdgeValue, F>
+            KERNEL_CONFIG(c)(
+                flagsOf(src),
+                src.capacity(),
+                srcVertices.elemsDevice,
+                compressedOffsets.elemsDevice,
+                compressedEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                f);
+        } else {
+            edgeMapKernel<VertexValue, AccumValue, EdgeValue, F>
+            KERNEL_CONFIG(c)(
+                flagsOf(src),
+                src.capacity(),
+                srcVertices.elemsDevice,
+                outgoingEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                f);
+        }
+        util::synchronize();
+    }
+
+    /**
+     * The pull counterpart of `edgeMap`: every vertex reads the values of its
+     * in-neighbors in `src` and reduces them in a private accumulator with
+     * `f.combine`, which needs no atomics since each accumulator is written
+     * by one thread only. Vertices without an in-neighbor in `src` end up
+     * with the default accumulator value.
+     *
+     * Requires the incoming edges, see `readGraph`.
+     * @param src  A subset of vertices the UDF will be applied to.
+     * @param f    The UDF applied to the edge, with `gather` and `combine`.
+     */
+    template<typename F>
+    void edgeMapPull(const VertexSubset &src, F f) {
+
+        assert(hasIncoming);
+
+        // Every accumulator is written, so none needs a reset.
+        dirtyAll = true;
+        edgeMapPull(flagsOf(src), f, typename std::is_empty<EdgeValue>::type());
+        util::synchronize();
     }
 
     /**
@@ -150,7 +359,7 @@ public:
         if (src.isDense) {
             auto c = util::kernelConfig(src.size());
             vertexMapDenseKernel<VertexValue, AccumValue, F>
-            <<< c.first, c.second>>>(
+            KERNEL_CONFIG(c)(
                 src.workqueue.elemsDevice,
                 src.qSizeDevice,
                 vertexValues.elemsDevice,
@@ -159,51 +368,216 @@ public:
         } else {
             auto c = util::kernelConfig(src.capacity());
             vertexMapSparseKernel<VertexValue, AccumValue, F>
-            <<< c.first, c.second>>>(
+            KERNEL_CONFIG(c)(
                 src.workset.elemsDevice,
                 src.capacity(),
                 vertexValues.elemsDevice,
                 accumulators.elemsDevice,
                 f);
         }
-        CUDA_CHECK(cudaThreadSynchronize());
+        util::synchronize();
     }
 
     /**
-     * Reduce the vertex value by specifying a reduce function
-     * @return The reduced result
+     * Reduces the values of the vertices in `src` to a single one, where
+     * they live: only the result is copied back to the host. `f.map` turns
+     * a vertex value into an accumulator value, and `f.combine` folds one
+     * into another, starting from `init`, which must be neutral to it.
+     *
+     * The values are combined in no particular order, so `f.combine` should
+     * be associative and commutative (up to rounding).
      */
-    AccumValue vertexReduce() {
-        vertexValues.persist();
-        AccumValue r = (AccumValue) 0;
-        for (int i = 0; i < vertexCount; i++) {
-            vertexValues[i].reduce(r);
+    template<typename F>
+    AccumValue vertexReduce(const VertexSubset &src, F f, AccumValue init) {
+        reserveReduction();
+        auto c = std::make_pair(REDUCE_BLOCKS, DEFAULT_THREADS_PER_BLOCK);
+        if (src.isDense) {
+            vertexReduceDenseKernel<VertexValue, AccumValue, F>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                vertexValues.elemsDevice,
+                reducePartials.elemsDevice,
+                init,
+                f);
+        } else {
+            vertexReduceSparseKernel<VertexValue, AccumValue, F>
+            KERNEL_CONFIG(c)(
+                src.workset.elemsDevice,
+                src.capacity(),
+                vertexValues.elemsDevice,
+                reducePartials.elemsDevice,
+                init,
+                f);
+        }
+        return combinePartials<F>(f, init);
+    }
+
+    /**
+     * One iteration of a fixed-point algorithm in a single sweep over the
+     * vertices: the effect of `edgeMapPull(src, edgeF)`, `vertexMap(src,
+     * vertexF)` and `vertexReduce(src, reduceF, init)` in a row, whose result
+     * it returns.
+     *
+     * Every vertex of `src` pulls its accumulator into a register, updates
+     * its value with it and folds the new value into the reduction at once.
+     * The accumulators are neither reset nor written, and only the gather
+     * of the sources, the sweep and the combination of the partial results
+     * are launched. Updating the values in place is safe as the sources are
+     * gathered beforehand, which needs edge values that carry no data.
+     *
+     * Otherwise, or without the incoming edges, the three operators run one
+     * after another, pushing with `edgeMap` in the latter case.
+     *
+     * @note The accumulators are left undefined by the fused sweep.
+     */
+    template<typename EF, typename VF, typename RF>
+    AccumValue superstep(const VertexSubset &src, EF edgeF, VF vertexF,
+                         RF reduceF, AccumValue init) {
+        if (!hasIncoming || !std::is_empty<EdgeValue>::value) {
+            if (hasIncoming) {
+                edgeMapPull<EF>(src, edgeF);
+            } else {
+                edgeMap<EF>(src, edgeF);
+            }
+            vertexMap<VF>(src, vertexF);
+            return vertexReduce<RF>(src, reduceF, init);
         }
-        return r;
+
+        if (contributions.capacity() == 0) contributions.reserve(vertexCount);
+        reserveReduction();
+        const Word *flags = flagsOf(src);
+        auto c = util::kernelConfig(vertexCount);
+        gatherSourcesKernel<VertexValue, AccumValue, EdgeValue, EF>
+        KERNEL_CONFIG(c)(
+            flags,
+            vertexCount,
+            srcVertices.elemsDevice,
+            vertexValues.elemsDevice,
+            contributions.elemsDevice,
+            edgeF);
+        superstepPullKernel<VertexValue, AccumValue, EF, VF, RF>
+        KERNEL_CONFIG(std::make_pair(REDUCE_BLOCKS, DEFAULT_THREADS_PER_BLOCK))(
+            flags,
+            vertexCount,
+            dstVertices.elemsDevice,
+            incomingEdges.elemsDevice,
+            contributions.elemsDevice,
+            vertexValues.elemsDevice,
+            reducePartials.elemsDevice,
+            defaultAccumValue,
+            init,
+            edgeF,
+            vertexF,
+            reduceF);
+        return combinePartials<RF>(reduceF, init);
     }
 
     /** Initialize with a default accumulator value  */
-    Oliver(AccumValue _accum) : defaultAccumValue(_accum) {}
+    Oliver(AccumValue _accum) : newIds(NULL), compressed(false),
+        hasIncoming(false), queueStamp(0), dirtyCount(0), dirtyAll(true),
+        hubCount(0), defaultAccumValue(_accum) {}
 
-    Oliver() : defaultAccumValue(0) {}
+    Oliver() : newIds(NULL), compressed(false), hasIncoming(false),
+        queueStamp(0), dirtyCount(0), dirtyAll(true), hubCount(0),
+        defaultAccumValue(0) {}
 
-    void readGraph(const CsrGraph<int, int> &graph) {
+    /**
+     * Loads the topology of `graph` into the engine. The CSR buffers of the
+     * graph are not copied on the host: the host backend works on them in
+     * place, and the GPU backend transfers them to the device directly.
+     *
+     * The edge values of the graph are loaded as well if they can be
+     * converted to `EdgeValue`, e.g. the weights for SSSP. Values of the very
+     * same type are shared with the graph like the topology.
+     *
+     * If the graph has been compressed with `CsrGraph::compress()`, only the
+     * gap-encoded adjacency is loaded, and the edge operators decode it on
+     * the fly. The incoming edges are loaded if the graph has built them with
+     * `CsrGraph::buildIncoming()`, which enables `edgeMapPull`.
+     *
+     * @note The graph must outlive the engine.
+     */
+    template<typename GraphVertexValue, typename GraphEdgeValue>
+    void readGraph(const CsrGraph<GraphVertexValue, GraphEdgeValue> &graph) {
         vertexCount = graph.vertexCount;
         edgeCount = graph.edgeCount;
-        srcVertices.reserve(vertexCount + 1);
-        outgoingEdges.reserve(edgeCount);
+        newIds = graph.newIds;
+        srcVertices.borrow(graph.vertices, vertexCount + 1);
+        compressed = (graph.compressedEdges != NULL);
+        if (compressed) {
+            ByteOffset bytes = graph.compressedOffsets[vertexCount];
+            compressedOffsets.borrow(graph.compressedOffsets, vertexCount + 1);
+            compressedEdges.borrow(graph.compressedEdges, bytes + COMPRESSED_PADDING);
+            compressedOffsets.cache();
+            compressedEdges.cache();
+        } else {
+            outgoingEdges.borrow(graph.edges, edgeCount);
+            outgoingEdges.cache();
+        }
         vertexValues.reserve(vertexCount);
         accumulators.reserve(vertexCount);
-        edgeValues.reserve(edgeCount);
-        memcpy(srcVertices.elemsHost, graph.vertices, sizeof(EdgeId) * (vertexCount + 1));
-        memcpy(outgoingEdges.elemsHost, graph.edges, sizeof(VertexId) * edgeCount);
+        dirtyAll = true;
+        findHubs(graph);
+        readEdgeValues(edgeValues, graph.edgeValues,
+                       typename std::is_same<EdgeValue, GraphEdgeValue>::type(),
+                       typename std::is_convertible<GraphEdgeValue, EdgeValue>::type());
         srcVertices.cache();
-        outgoingEdges.cache();
+
+        hasIncoming = (graph.inVertices != NULL);
+        if (hasIncoming) {
+            dstVertices.borrow(graph.inVertices, vertexCount + 1);
+            incomingEdges.borrow(graph.inEdges, edgeCount);
+            readEdgeValues(incomingEdgeValues, graph.inEdgeValues,
+                           typename std::is_same<EdgeValue, GraphEdgeValue>::type(),
+                           typename std::is_convertible<GraphEdgeValue, EdgeValue>::type());
+            dstVertices.cache();
+            incomingEdges.cache();
+        }
     }
 
+    /**
+     * Splits every row for the sliced `edgeFilter`: the row of vertex `v`
+     * splits at edge `splits[v]`, which is within the row. The splits are
+     * copied.
+     */
+    void readRowSplits(const EdgeId *splits) {
+        assert(!compressed);
+        if (rowSplits.capacity() == 0) rowSplits.reserve(vertexCount);
+        for (VertexId v = 0; v < vertexCount; v++) {
+            rowSplits[v] = splits[v];
+        }
+        rowSplits.cache();
+    }
+
+    /**
+     * Prints the vertex values in the order of the input ids, even if the
+     * graph has been reordered.
+     */
     inline void printVertices() {
         vertexValues.persist();
-        vertexValues.print();
+        if (newIds == NULL) {
+            vertexValues.print();
+            return;
+        }
+        for (VertexId v = 0; v < vertexCount; v++) {
+            vertexValues[newIds[v]].print();
+        }
+    }
+
+    /** Copies the vertex values back to the host and returns them. */
+    inline const VertexValue *getVertexValues() {
+        vertexValues.persist();
+        return vertexValues.elemsHost;
+    }
+
+    /**
+     * Sets the value of vertex `v`, an id of the engine (see
+     * `CsrGraph::toNewId`), e.g. to seed a traversal with a different value
+     * at each of its sources.
+     */
+    inline void setVertexValue(VertexId v, const VertexValue &value) {
+        vertexValues.set(v, value);
     }
 
     inline void printEdges() {
@@ -219,30 +593,535 @@ public:
     ~Oliver() {
         srcVertices.del();
         outgoingEdges.del();
+        compressedOffsets.del();
+        compressedEdges.del();
+        dstVertices.del();
+        incomingEdges.del();
+        incomingEdgeValues.del();
+        contributions.del();
+        frontierFlags.del();
+        queueStamps.del();
+        edgeTotal.del();
+        frontierOffsets.del();
+        degreeSamples.del();
+        reducePartials.del();
+        reduceResult.del();
+        dirtyQueue.del();
+        dirtyQueueSize.del();
+        hubFlags.del();
+        hubSlots.del();
+        hubVertices.del();
+        hubPartials.del();
+        hubTouched.del();
         vertexValues.del();
         accumulators.del();
         edgeValues.del();
+        rowSplits.del();
     }
 
 private:
+    /**
+     * Runs a top-down step over a `slice` of the rows, choosing the
+     * `GroupSize` if `ADAPTIVE`.
+     */
+    template<typename F, int GroupSize>
+    void topDown(VertexSubset &dst, const VertexSubset &src, F f,
+                 EdgeId frontierEdges, RowSlice slice) {
+        if (GroupSize != ADAPTIVE) {
+            edgeFilterPush<F, GroupSize == ADAPTIVE ? 1 : GroupSize>(
+                dst, src, f, frontierEdges, slice);
+            return;
+        }
+        int group = chooseGroupSize(src, frontierEdges, slice);
+        double start = getTimeMillis();
+        switch (group) {
+            case LOAD_BALANCED:
+                edgeFilterPush<F, LOAD_BALANCED>(dst, src, f, frontierEdges, slice); break;
+            case 1:  edgeFilterPush<F, 1>(dst, src, f, frontierEdges, slice); break;
+            case 2:  edgeFilterPush<F, 2>(dst, src, f, frontierEdges, slice); break;
+            case 4:  edgeFilterPush<F, 4>(dst, src, f, frontierEdges, slice); break;
+            case 8:  edgeFilterPush<F, 8>(dst, src, f, frontierEdges, slice); break;
+            case 16: edgeFilterPush<F, 16>(dst, src, f, frontierEdges, slice); break;
+            default: edgeFilterPush<F, 32>(dst, src, f, frontierEdges, slice); break;
+        }
+        std::string choice = (group == LOAD_BALANCED) ? std::string("load-balanced") :
+                             "GroupSize " + std::to_string(group);
+        LOG(DEBUG1) << "edgeFilter: " << src.size() << " vertices, " << frontierEdges
+                    << " edges, " << choice << ", " << getTimeMillis() - start << "ms";
+    }
+
+    /** The top-down step of `edgeFilter` from queue `src`. */
+    template<typename F, int GroupSize>
+    void edgeFilterPush(VertexSubset &dst, const VertexSubset &src, F f,
+                        EdgeId frontierEdges, RowSlice slice) {
+        VertexId size = src.size();
+        bool dense = size + frontierEdges > edgeCount / DENSE_FRONTIER_DIVISOR;
+
+        // Reset the accumulators before the gather phase starts
+        resetAccumulators();
+
+        if (dense) {
+            dst.clearAsFlags();
+            expand<F, GroupSize, false>(dst, src, 0, frontierEdges, slice, f);
+            dirtyAll = true;
+        } else {
+            // A sparse step dedupes its queue by stamping the vertices with
+            // a number of its own, so the stamps never need a reset.
+            dst.clearAsQueue();
+            if (queueStamps.capacity() == 0 || queueStamp == INT_MAX) {
+                if (queueStamps.capacity() == 0) queueStamps.reserve(vertexCount);
+                queueStamps.clear();
+                queueStamp = 0;
+            }
+            queueStamp++;
+            expand<F, GroupSize, true>(dst, src, queueStamp, frontierEdges, slice, f);
+        }
+        util::synchronize();
+        if (!dense) keepDirty(dst);
+    }
+
+    /**
+     * Resets the accumulators written since the last reset: only those of
+     * the output of the last step if it was sparse, all of them otherwise.
+     */
+    void resetAccumulators() {
+        if (dirtyAll) {
+            accumulators.allTo(defaultAccumValue);
+        } else if (dirtyCount > 0) {
+            auto c = util::kernelConfig(dirtyCount);
+            markQueueKernel<AccumValue> KERNEL_CONFIG(c)(
+                dirtyQueue.elemsDevice,
+                dirtyQueueSize.elemsDevice,
+                accumulators.elemsDevice,
+                defaultAccumValue);
+            util::synchronize();
+        }
+        dirtyAll = false;
+        dirtyCount = 0;
+    }
+
+    /**
+     * Records the output queue of a sparse step as the accumulators to
+     * reset, since the caller is free to reuse `dst` in between.
+     */
+    void keepDirty(const VertexSubset &dst) {
+        if (dirtyQueue.capacity() == 0) {
+            dirtyQueue.reserve(vertexCount);
+            dirtyQueueSize.reserve(1);
+        }
+        dirtyAll = false;
+        dirtyCount = dst.size();
+        if (dirtyCount == 0) return;
+        auto c = util::kernelConfig(dirtyCount);
+        copyQueueKernel KERNEL_CONFIG(c)(
+            dst.workqueue.elemsDevice,
+            dst.qSizeDevice,
+            dirtyQueue.elemsDevice,
+            dirtyQueueSize.elemsDevice);
+    }
+
+    /**
+     * Launches the expansion kernel of the layout of the edges over a
+     * `slice` of the rows, which flags the bits of `dst`, or with `ToQueue`
+     * queues into it the vertices it gives `stamp`.
+     */
+    template<typename F, int GroupSize, bool ToQueue>
+    void expand(VertexSubset &dst, const VertexSubset &src, int stamp,
+                EdgeId frontierEdges, RowSlice slice, F f) {
+        Word *flags = ToQueue ? NULL : dst.workset.elemsDevice;
+        int *stamps = ToQueue ? queueStamps.elemsDevice : NULL;
+        VertexId *outQueue = ToQueue ? dst.workqueue.elemsDevice : NULL;
+        VertexId *outQueueSize = ToQueue ? dst.qSizeDevice : NULL;
+        if (GroupSize == LOAD_BALANCED) {
+            expandBalanced<F, ToQueue>(src, flags, stamps, stamp, outQueue,
+                                       outQueueSize, frontierEdges, slice, f);
+            return;
+        }
+        // Not LOAD_BALANCED from here on, which only keeps the kernels sane.
+        const int Group = GroupSize == LOAD_BALANCED ? 1 : GroupSize;
+        auto c = util::kernelConfig(src.size() * Group);
+        if (compressed) {
+            edgeFilterCompressedKernel<VertexValue, AccumValue, EdgeValue, F, Group, ToQueue>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                srcVertices.elemsDevice,
+                compressedOffsets.elemsDevice,
+                compressedEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                flags,
+                stamps,
+                outQueue,
+                outQueueSize,
+                stamp,
+                f);
+        } else {
+            edgeFilterKernel<VertexValue, AccumValue, EdgeValue, F, Group, ToQueue>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                rowStarts(slice),
+                rowEnds(slice),
+                outgoingEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                flags,
+                stamps,
+                outQueue,
+                outQueueSize,
+                stamp,
+                f);
+        }
+    }
+
+    /**
+     * Expands queue `src` with its edges split evenly: the scan of the
+     * degrees of the frontier tells where each edge comes from.
+     */
+    template<typename F, bool ToQueue>
+    void expandBalanced(const VertexSubset &src, Word *flags, int *stamps,
+                        int stamp, VertexId *outQueue, VertexId *outQueueSize,
+                        EdgeId frontierEdges, RowSlice slice, F f) {
+        if (frontierOffsets.capacity() == 0) frontierOffsets.reserve(vertexCount + 1);
+        auto c = util::kernelConfig(src.size());
+        frontierDegreesKernel KERNEL_CONFIG(c)(
+            src.workqueue.elemsDevice,
+            src.qSizeDevice,
+            rowStarts(slice),
+            rowEnds(slice),
+            frontierOffsets.elemsDevice);
+        frontierScanKernel KERNEL_CONFIG(std::make_pair(1, MAX_THREADS_PER_BLOCK))(
+            frontierOffsets.elemsDevice,
+            src.qSizeDevice);
+
+        c = util::kernelConfig(frontierEdges);
+        if (compressed) {
+            edgeFilterBalancedCompressedKernel<VertexValue, AccumValue, EdgeValue, F, ToQueue>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                frontierOffsets.elemsDevice,
+                srcVertices.elemsDevice,
+                compressedOffsets.elemsDevice,
+                compressedEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                flags,
+                stamps,
+                outQueue,
+                outQueueSize,
+                stamp,
+                f);
+        } else {
+            edgeFilterBalancedKernel<VertexValue, AccumValue, EdgeValue, F, ToQueue>
+            KERNEL_CONFIG(c)(
+                src.workqueue.elemsDevice,
+                src.qSizeDevice,
+                frontierOffsets.elemsDevice,
+                rowStarts(slice),
+                rowEnds(slice),
+                outgoingEdges.elemsDevice,
+                vertexValues.elemsDevice,
+                accumulators.elemsDevice,
+                hubs(),
+                edgeValues.elemsDevice,
+                flags,
+                stamps,
+                outQueue,
+                outQueueSize,
+                stamp,
+                f);
+        }
+    }
+
+    /** Where the rows of a `slice` start on the device. */
+    const EdgeId *rowStarts(RowSlice slice) const {
+        assert(slice == WHOLE_ROWS || (rowSplits.capacity() > 0 && !compressed));
+        return slice == FROM_SPLIT ? rowSplits.elemsDevice : srcVertices.elemsDevice;
+    }
+
+    /** Where the rows of a `slice` end on the device. */
+    const EdgeId *rowEnds(RowSlice slice) const {
+        assert(slice == WHOLE_ROWS || (rowSplits.capacity() > 0 && !compressed));
+        return slice == BEFORE_SPLIT ? rowSplits.elemsDevice : srcVertices.elemsDevice + 1;
+    }
+
+    /**
+     * Picks the hubs among the destinations of `graph`, by the in-degrees of
+     * the incoming edges if it has built them, or else by counting the
+     * outgoing ones. Edges into a hub are reduced into private slots by
+     * the push operators, see `HubAccumulators`, which only changes the
+     * order `f.reduce` sees them in.
+     */
+    template<typename GraphVertexValue, typename GraphEdgeValue>
+    void findHubs(const CsrGraph<GraphVertexValue, GraphEdgeValue> &graph) {
+        hubCount = 0;
+        if (vertexCount == 0) return;
+#ifdef OLIVE_HOST
+        // A single worker contends with nobody.
+        if (ThreadPool::get().size() == 1) return;
+#endif
+        std::vector<EdgeId> inDegrees(vertexCount, 0);
+        if (graph.inVertices != NULL) {
+            for (VertexId v = 0; v < vertexCount; v++) {
+                inDegrees[v] = graph.inVertices[v + 1] - graph.inVertices[v];
+            }
+        } else {
+            ThreadPool::get().parallelFor(vertexCount, [&](size_t begin, size_t end, int) {
+                std::vector<VertexId> neighbors;
+                for (VertexId v = begin; v < end; v++) {
+                    neighbors.resize(graph.vertices[v + 1] - graph.vertices[v]);
+                    graph.getNeighbors(v, neighbors.data());
+                    for (size_t i = 0; i < neighbors.size(); i++) {
+                        util::fetchAdd(&inDegrees[neighbors[i]], EdgeId(1));
+                    }
+                }
+            });
+        }
+
+        EdgeId threshold = std::max(HUB_MIN_IN_DEGREE, edgeCount / vertexCount * HUB_SKEW);
+        std::vector<VertexId> candidates;
+        for (VertexId v = 0; v < vertexCount; v++) {
+            if (inDegrees[v] >= threshold) candidates.push_back(v);
+        }
+        if (candidates.empty()) return;
+        if (candidates.size() > static_cast<size_t>(MAX_HUBS)) {
+            std::partial_sort(candidates.begin(), candidates.begin() + MAX_HUBS, candidates.end(),
+                [&](VertexId a, VertexId b) { return inDegrees[a] > inDegrees[b]; });
+            candidates.resize(MAX_HUBS);
+        }
+        hubCount = candidates.size();
+
+        hubFlags.reserve(bitmap::wordCount(vertexCount));
+        hubSlots.reserve(vertexCount);
+        hubVertices.reserve(hubCount);
+        memset(hubFlags.elemsHost, 0, sizeof(Word) * hubFlags.capacity());
+        for (int h = 0; h < hubCount; h++) {
+            bitmap::set(hubFlags.elemsHost, candidates[h]);
+            hubSlots[candidates[h]] = h;
+            hubVertices[h] = candidates[h];
+        }
+        hubFlags.cache();
+        hubSlots.cache();
+        hubVertices.cache();
+#ifdef OLIVE_HOST
+        hubPartials.reserve(hubCount * ThreadPool::get().size());
+        hubTouched.reserve(hubCount * ThreadPool::get().size());
+        hubTouched.clear();
+#endif
+        LOG(DEBUG1) << "Privatizing the accumulators of " << hubCount
+                   << " hubs of in-degree " << threshold << " or more.";
+    }
+
+    /** The hubs as the push kernels take them. */
+    HubAccumulators<AccumValue> hubs() const {
+        HubAccumulators<AccumValue> h;
+        h.flags = hubFlags.elemsDevice;
+        h.slots = hubSlots.elemsDevice;
+        h.vertices = hubVertices.elemsDevice;
+        h.count = hubCount;
+        h.init = defaultAccumValue;
+        h.partials = hubPartials.elemsDevice;
+        h.touched = hubTouched.elemsDevice;
+        return h;
+    }
+
+    /** Allocates the partial and final results of a vertex reduction. */
+    void reserveReduction() {
+        if (reduceResult.capacity() > 0) return;
+        reducePartials.reserve(reducePartialCount());
+        reduceResult.reserve(1);
+    }
+
+    /**
+     * Combines the `reducePartialCount()` partial results of a vertex
+     * reduction, and copies the result back.
+     */
+    template<typename F>
+    AccumValue combinePartials(F f, AccumValue init) {
+        combinePartialsKernel<AccumValue, F>
+        KERNEL_CONFIG(std::make_pair(1, REDUCE_BLOCKS))(
+            reducePartials.elemsDevice,
+            reduceResult.elemsDevice,
+            init,
+            f);
+        util::synchronize();
+        reduceResult.persist();
+        return reduceResult[0];
+    }
+
+    /**
+     * Returns the flags of `src`. A dense subset is flagged in scratch
+     * space, which is valid until the next call.
+     */
+    const Word *flagsOf(const VertexSubset &src) {
+        if (!src.isDense) return src.workset.elemsDevice;
+        if (frontierFlags.capacity() == 0) {
+            frontierFlags.reserve(bitmap::wordCount(vertexCount));
+        }
+        frontierFlags.clear();
+        auto c = util::kernelConfig(src.size());
+        queueToFlagsKernel KERNEL_CONFIG(c)(
+            src.workqueue.elemsDevice,
+            src.qSizeDevice,
+            frontierFlags.elemsDevice);
+        util::synchronize();
+        return frontierFlags.elemsDevice;
+    }
+
+    /** Pulls the gather of every in-edge. */
+    template<typename F>
+    void edgeMapPull(const Word *src, F f, std::false_type) {
+        auto c = util::kernelConfig(vertexCount);
+        edgeMapPullKernel<VertexValue, AccumValue, EdgeValue, F>
+        KERNEL_CONFIG(c)(
+            src,
+            vertexCount,
+            srcVertices.elemsDevice,
+            dstVertices.elemsDevice,
+            incomingEdges.elemsDevice,
+            vertexValues.elemsDevice,
+            accumulators.elemsDevice,
+            incomingEdgeValues.elemsDevice,
+            defaultAccumValue,
+            f);
+    }
+
+    /**
+     * Without edge values the gather only depends on the source, so it is
+     * done once per source, and the edges pull the results.
+     */
+    template<typename F>
+    void edgeMapPull(const Word *src, F f, std::true_type) {
+        if (contributions.capacity() == 0) contributions.reserve(vertexCount);
+        auto c = util::kernelConfig(vertexCount);
+        gatherSourcesKernel<VertexValue, AccumValue, EdgeValue, F>
+        KERNEL_CONFIG(c)(
+            src,
+            vertexCount,
+            srcVertices.elemsDevice,
+            vertexValues.elemsDevice,
+            contributions.elemsDevice,
+            f);
+        edgeMapPullGatheredKernel<AccumValue, F>
+        KERNEL_CONFIG(c)(
+            src,
+            vertexCount,
+            dstVertices.elemsDevice,
+            incomingEdges.elemsDevice,
+            contributions.elemsDevice,
+            accumulators.elemsDevice,
+            defaultAccumValue,
+            f);
+    }
+
+    /** The graph has edge values of the same type: share them. */
+    template<typename GraphEdgeValue, typename Convertible>
+    void readEdgeValues(GRD<EdgeValue> &target, GraphEdgeValue *values,
+                        std::true_type, Convertible) {
+        target.borrow(values, edgeCount);
+        target.cache();
+    }
+
+    /** The graph has edge values of another type: convert them. */
+    template<typename GraphEdgeValue>
+    void readEdgeValues(GRD<EdgeValue> &target, GraphEdgeValue *values,
+                        std::false_type, std::true_type) {
+        target.reserve(edgeCount);
+        for (EdgeId e = 0; e < edgeCount; e++) {
+            target[e] = values[e];
+        }
+        target.cache();
+    }
+
+    /** The edge values are unrelated to the graph, e.g. `Dump_Edge`. */
+    template<typename GraphEdgeValue>
+    void readEdgeValues(GRD<EdgeValue> &target, GraphEdgeValue *values,
+                        std::false_type, std::false_type) {
+        target.reserve(edgeCount);
+    }
+
     /** Record the edge and vertex number of each partition. */
     VertexId         vertexCount;
     EdgeId           edgeCount;
 
+    /** The input-to-graph id map of a reordered graph, or NULL. */
+    const VertexId  *newIds;
+
     /**
      * CSR related data structure.
      */
     GRD<EdgeId>      srcVertices;
+    GRD<EdgeId>      rowSplits;     /** See `readRowSplits` */
     GRD<VertexId>    outgoingEdges;
 
-    // GRD<EdgeId>      dstVertices;
-    // GRD<VertexId>    incomingEdges;
+    /** Gap-encoded `outgoingEdges`, used instead of it if `compressed`. */
+    GRD<ByteOffset>    compressedOffsets;
+    GRD<unsigned char> compressedEdges;
+    bool               compressed;
+
+    /** The incoming edges (CSC), loaded only if `hasIncoming`. */
+    GRD<EdgeId>      dstVertices;
+    GRD<VertexId>    incomingEdges;
+    GRD<EdgeValue>   incomingEdgeValues;
+    bool             hasIncoming;
+
+    /** What each source gathers, see `edgeMapPull`. Allocated on demand. */
+    GRD<AccumValue>  contributions;
+
+    /**
+     * Scratch of the frontier operators, allocated on demand: the bitmap of
+     * a dense subset (`flagsOf`), the stamps deduping the queue of a sparse
+     * step and the stamp of the last one, the out-edge count, the scan of
+     * the degrees of the frontier (`LOAD_BALANCED`), and the degrees
+     * sampled by `chooseGroupSize`.
+     */
+    GRD<Word>        frontierFlags;
+    GRD<int>         queueStamps;
+    int              queueStamp;
+    GRD<EdgeId>      edgeTotal;
+    GRD<EdgeId>      frontierOffsets;
+    GRD<EdgeId>      degreeSamples;
+
+    /** The partial and final results of `vertexReduce`, allocated on demand. */
+    GRD<AccumValue>  reducePartials;
+    GRD<AccumValue>  reduceResult;
 
     /**
      * Vertex-wise state.
      */
     GRD<VertexValue> vertexValues;
     GRD<AccumValue>  accumulators;
+
+    /**
+     * The accumulators written since their last reset: all of them if
+     * `dirtyAll`, otherwise the `dirtyCount` vertices of `dirtyQueue`,
+     * i.e. the output of the last sparse step.
+     */
+    GRD<VertexId>    dirtyQueue;
+    GRD<VertexId>    dirtyQueueSize;
+    VertexId         dirtyCount;
+    bool             dirtyAll;
+
+    /**
+     * The hubs, see `findHubs`: their bitmap, the slot of each hub and the
+     * hub of each slot. The host workers keep their slots in `hubPartials`,
+     * the GPU blocks in shared memory.
+     */
+    GRD<Word>        hubFlags;
+    GRD<int>         hubSlots;
+    GRD<VertexId>    hubVertices;
+    int              hubCount;
+    GRD<AccumValue>  hubPartials;
+    GRD<int>         hubTouched;
+
     GRD<EdgeValue>   edgeValues;
     AccumValue       defaultAccumValue;
 
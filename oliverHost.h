@@ -0,0 +1,964 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * The host counterparts of the kernels in oliverKernel.h.
+ *
+ * Each function takes exactly the same parameters as its CUDA kernel, so that
+ * Oliver launches either of them with `KERNEL_CONFIG`. The work is split into
+ * chunks and handed out dynamically to the workers of the thread pool.
+ */
+
+#ifndef OLIVER_HOST_H
+#define OLIVER_HOST_H
+
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+#include "bitmap.h"
+#include "compressedAdjacency.h"
+#include "threadPool.h"
+#include "utils.h"
+
+/**
+ * Chunk size when iterating over every vertex of the graph. Big enough to
+ * amortize the dispatch, small enough to balance skewed vertex costs.
+ */
+const size_t HOST_VERTEX_GRAIN = 4096;
+
+/**
+ * Chunk size when iterating over a frontier, whose entries each expand
+ * a whole adjacency list.
+ */
+const size_t HOST_FRONTIER_GRAIN = 64;
+
+/** Chunk size of the load-balanced expansion, in edges. */
+const size_t HOST_EDGE_GRAIN = 4096;
+
+
+/**
+ * Activates `v` in the output of an edge expansion: sets its bit in `flags`,
+ * or with `ToQueue` stamps it instead. The first to stamp `v` with the
+ * `stamp` of the current step queues it, into the chunk-local queue.
+ */
+template<bool ToQueue>
+inline void activate(Word *flags, int *stamps, VertexId v, int stamp,
+                     std::vector<VertexId> &localQueue) {
+    if (!ToQueue) {
+        bitmap::set(flags, v);
+    } else if (stamps[v] != stamp && atomicExch(&stamps[v], stamp) != stamp) {
+        localQueue.push_back(v);
+    }
+}
+
+/** Appends a chunk-local queue to the global one. */
+inline void flushQueue(const std::vector<VertexId> &localQueue,
+                       VertexId *workqueue, VertexId *workqueueSize) {
+    if (localQueue.empty()) return;
+    VertexId pos = atomicAdd(workqueueSize, localQueue.size());
+    std::copy(localQueue.begin(), localQueue.end(), workqueue + pos);
+}
+
+/**
+ * Reduces `accum` into the accumulator of `v`, or into the slot of worker
+ * `wid` if `v` is a hub. A worker owns its slots, so the first edge into a
+ * hub just stores its value there.
+ */
+template<typename AccumValue, typename F>
+inline void reduceAccumulator(AccumValue *accumulators,
+                              const HubAccumulators<AccumValue> &hubs,
+                              VertexId v, AccumValue accum, int wid, F &f) {
+    if (hubs.count == 0 || !bitmap::get(hubs.flags, v)) {
+        f.reduce(accumulators[v], accum);
+        return;
+    }
+    size_t slot = static_cast<size_t>(wid) * hubs.count + hubs.slots[v];
+    if (hubs.touched[slot]) {
+        f.reduce(hubs.partials[slot], accum);
+    } else {
+        hubs.partials[slot] = accum;
+        hubs.touched[slot] = 1;
+    }
+}
+
+/**
+ * Reduces the slots the workers have touched into the accumulators of the
+ * hubs, by worker order, and clears them for the next kernel.
+ */
+template<typename AccumValue, typename F>
+inline void combineHubs(AccumValue *accumulators,
+                        const HubAccumulators<AccumValue> &hubs, F &f) {
+    int workers = ThreadPool::get().size();
+    for (int h = 0; h < hubs.count; h++) {
+        for (int w = 0; w < workers; w++) {
+            size_t slot = static_cast<size_t>(w) * hubs.count + h;
+            if (!hubs.touched[slot]) continue;
+            f.reduce(accumulators[hubs.vertices[h]], hubs.partials[slot]);
+            hubs.touched[slot] = 0;
+        }
+    }
+}
+
+/**
+ * Expands the vertices in the work queue. `GroupSize` only matters to the
+ * GPU, where it is the number of lanes sharing an adjacency list.
+ *
+ * The edges of vertex `v` are those in [`rowStarts[v]`, `rowEnds[v]`), which
+ * is its whole row unless the engine scans a slice of it, see `RowSlice`.
+ * `f.gather` is given the number of those edges as the out-degree.
+ *
+ * The destinations are flagged in `flags`. With `ToQueue` they are
+ * appended to `outQueue` instead, once each, see `activate`.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         int GroupSize,
+         bool ToQueue>
+void edgeFilterKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    const VertexId *outgoingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue      *edgeValues,
+    Word           *flags,
+
+    int            *stamps,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize,
+    int             stamp,
+    F f)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int wid) {
+        std::vector<VertexId> localQueue;
+        for (size_t g = begin; g < end; g++) {
+            VertexId srcId = workqueue[g];
+
+            EdgeId start = rowStarts[srcId];
+            EdgeId last = rowEnds[srcId];
+            EdgeId outdegree = last - start;
+            VertexValue srcValue = vertexValues[srcId];
+
+            for (EdgeId e = start; e < last; e++) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                VertexId dstId = outgoingEdges[e];
+                reduceAccumulator(accumulators, hubs, dstId, accum, wid, f);
+                activate<ToQueue>(flags, stamps, dstId, stamp, localQueue);
+            }
+        }
+        if (ToQueue) flushQueue(localQueue, outQueue, outQueueSize);
+    }, HOST_FRONTIER_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+/**
+ * `edgeFilterKernel` over the gap-encoded adjacency. The neighbors are
+ * decoded while streaming through each row.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         int GroupSize,
+         bool ToQueue>
+void edgeFilterCompressedKernel(
+    const VertexId      *workqueue,
+    const VertexId      *workqueueSize,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    Word                *flags,
+
+    int                 *stamps,
+    VertexId            *outQueue,
+    VertexId            *outQueueSize,
+    int                  stamp,
+    F f)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int wid) {
+        std::vector<VertexId> localQueue;
+        for (size_t g = begin; g < end; g++) {
+            VertexId srcId = workqueue[g];
+
+            EdgeId start = vertices[srcId];
+            EdgeId outdegree = vertices[srcId + 1] - start;
+            if (outdegree == 0) continue;
+            VertexValue srcValue = vertexValues[srcId];
+
+            const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+            EdgeId blocks = compressed::numBlocks(outdegree);
+            for (EdgeId b = 0; b < blocks; b++) {
+                compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+                EdgeId e = start + b * COMPRESSED_BLOCK_SIZE;
+                EdgeId last = std::min(e + COMPRESSED_BLOCK_SIZE, start + outdegree);
+                while (true) {
+                    AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                    reduceAccumulator(accumulators, hubs, decoder.dst, accum, wid, f);
+                    activate<ToQueue>(flags, stamps, decoder.dst, stamp, localQueue);
+                    if (++e == last) break;
+                    decoder.next();
+                }
+            }
+        }
+        if (ToQueue) flushQueue(localQueue, outQueue, outQueueSize);
+    }, HOST_FRONTIER_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+/**
+ * Writes the degree of every vertex in the work queue, within its row
+ * bounds, followed by a 0 which the exclusive scan turns into the total.
+ */
+inline void frontierDegreesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *degrees)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int) {
+        for (size_t pos = begin; pos < end; pos++) {
+            VertexId v = workqueue[pos];
+            degrees[pos] = rowEnds[v] - rowStarts[v];
+        }
+    }, HOST_VERTEX_GRAIN);
+    degrees[*workqueueSize] = 0;
+}
+
+/** Exclusive scan of the `*count + 1` entries of `data`. */
+inline void frontierScanKernel(
+    EdgeId         *data,
+    const VertexId *count)
+{
+    util::prefixSum(data, *count + 1);
+}
+
+/**
+ * Finds the position in the work queue of the vertex that owns rank `r` in
+ * the concatenated edges of the frontier. `offsets` is the scan of the
+ * degrees.
+ */
+inline VertexId frontierOwner(const EdgeId *offsets, VertexId size, EdgeId r) {
+    return std::upper_bound(offsets, offsets + size + 1, r) - offsets - 1;
+}
+
+/**
+ * `edgeFilterKernel` with the edges of the frontier split evenly between
+ * the chunks, whatever the degrees: a chunk starts at the vertex owning its
+ * first edge, found by a binary search in the scan of the degrees, and
+ * walks the adjacency lists from there. A hub is expanded by many chunks.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         bool ToQueue>
+void edgeFilterBalancedKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *offsets,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    const VertexId *outgoingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue      *edgeValues,
+    Word           *flags,
+
+    int            *stamps,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize,
+    int             stamp,
+    F f)
+{
+    VertexId size = *workqueueSize;
+    ThreadPool::get().parallelFor(offsets[size],
+    [&](size_t begin, size_t end, int wid) {
+        std::vector<VertexId> localQueue;
+        for (VertexId g = frontierOwner(offsets, size, begin); begin < end; g++) {
+            EdgeId stop = std::min<EdgeId>(end, offsets[g + 1]);
+            if (stop == begin) continue;
+            VertexId srcId = workqueue[g];
+            EdgeId start = rowStarts[srcId];
+            EdgeId outdegree = rowEnds[srcId] - start;
+            VertexValue srcValue = vertexValues[srcId];
+
+            EdgeId last = start + (stop - offsets[g]);
+            for (EdgeId e = start + (begin - offsets[g]); e < last; e++) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                VertexId dstId = outgoingEdges[e];
+                reduceAccumulator(accumulators, hubs, dstId, accum, wid, f);
+                activate<ToQueue>(flags, stamps, dstId, stamp, localQueue);
+            }
+            begin = stop;
+        }
+        if (ToQueue) flushQueue(localQueue, outQueue, outQueueSize);
+    }, HOST_EDGE_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+/**
+ * `edgeFilterBalancedKernel` over the gap-encoded adjacency. A chunk
+ * starting in the middle of a row decodes from the beginning of the block
+ * of its first edge.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         bool ToQueue>
+void edgeFilterBalancedCompressedKernel(
+    const VertexId      *workqueue,
+    const VertexId      *workqueueSize,
+    const EdgeId        *offsets,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    Word                *flags,
+
+    int                 *stamps,
+    VertexId            *outQueue,
+    VertexId            *outQueueSize,
+    int                  stamp,
+    F f)
+{
+    VertexId size = *workqueueSize;
+    ThreadPool::get().parallelFor(offsets[size],
+    [&](size_t begin, size_t end, int wid) {
+        std::vector<VertexId> localQueue;
+        for (VertexId g = frontierOwner(offsets, size, begin); begin < end; g++) {
+            EdgeId stop = std::min<EdgeId>(end, offsets[g + 1]);
+            if (stop == begin) continue;
+            VertexId srcId = workqueue[g];
+            EdgeId start = vertices[srcId];
+            EdgeId outdegree = vertices[srcId + 1] - start;
+            VertexValue srcValue = vertexValues[srcId];
+
+            const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+            EdgeId blocks = compressed::numBlocks(outdegree);
+            EdgeId i = begin - offsets[g];
+            EdgeId last = stop - offsets[g];
+            while (i < last) {
+                EdgeId b = i / COMPRESSED_BLOCK_SIZE;
+                compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+                for (EdgeId skip = b * COMPRESSED_BLOCK_SIZE; skip < i; skip++) {
+                    decoder.next();
+                }
+                EdgeId blockLast = std::min((b + 1) * COMPRESSED_BLOCK_SIZE, last);
+                while (true) {
+                    AccumValue accum = f.gather(srcValue, outdegree, edgeValues[start + i]);
+                    reduceAccumulator(accumulators, hubs, decoder.dst, accum, wid, f);
+                    activate<ToQueue>(flags, stamps, decoder.dst, stamp, localQueue);
+                    if (++i == blockLast) break;
+                    decoder.next();
+                }
+            }
+            begin = stop;
+        }
+        if (ToQueue) flushQueue(localQueue, outQueue, outQueueSize);
+    }, HOST_EDGE_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+/**
+ * The bottom-up step of a traversal. Every vertex still satisfying
+ * `f.cond` looks through its in-edges for a source in `frontier`, and
+ * stops at the first one it finds.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+void edgeFilterPullKernel(
+    const Word     *frontier,
+    VertexId        vertexCount,
+    const EdgeId   *vertices,
+    const EdgeId   *dstVertices,
+    const VertexId *incomingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    EdgeValue      *incomingEdgeValues,
+    Word           *workset,
+    F f)
+{
+    ThreadPool::get().parallelFor(vertexCount,
+    [&](size_t begin, size_t end, int) {
+        for (VertexId dstId = begin; dstId < end; dstId++) {
+            if (!f.cond(vertexValues[dstId])) continue;
+
+            EdgeId last = dstVertices[dstId + 1];
+            for (EdgeId e = dstVertices[dstId]; e < last; e++) {
+                VertexId srcId = incomingEdges[e];
+                if (!bitmap::get(frontier, srcId)) continue;
+                EdgeId outdegree = vertices[srcId + 1] - vertices[srcId];
+                f.reduce(accumulators[dstId], f.gather(vertexValues[srcId], outdegree,
+                                                       incomingEdgeValues[e]));
+                bitmap::set(workset, dstId);
+                break;
+            }
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * Sets the flag of every vertex in the work queue to `value`, or any other
+ * per-vertex element, e.g. its accumulator.
+ */
+template<typename T>
+void markQueueKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    T              *flags,
+    T               value)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int) {
+        for (size_t pos = begin; pos < end; pos++) {
+            flags[workqueue[pos]] = value;
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/** Copies the work queue and its size. */
+inline void copyQueueKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize)
+{
+    std::copy(workqueue, workqueue + *workqueueSize, outQueue);
+    *outQueueSize = *workqueueSize;
+}
+
+/** Sets the bit of every vertex in the work queue. */
+inline void queueToFlagsKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    Word           *flags)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int) {
+        for (size_t pos = begin; pos < end; pos++) {
+            bitmap::set(flags, workqueue[pos]);
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * Appends the flagged vertices to the work queue, by increasing id, with
+ * `bitmap::toList`.
+ */
+inline void flagsToQueueKernel(
+    const Word *flags,
+    VertexId    flagCount,
+    VertexId   *workqueue,
+    VertexId   *workqueueSize)
+{
+    *workqueueSize += bitmap::toList(flags, bitmap::wordCount(flagCount),
+                                     workqueue + *workqueueSize,
+                                     HOST_VERTEX_GRAIN / bitmap::WORD_BITS);
+}
+
+/** Adds the number of set flags to `count`, with `bitmap::count`. */
+inline void countFlagsKernel(
+    const Word *flags,
+    VertexId    flagCount,
+    VertexId   *count)
+{
+    *count += bitmap::count(flags, bitmap::wordCount(flagCount),
+                            HOST_VERTEX_GRAIN / bitmap::WORD_BITS);
+}
+
+/**
+ * Adds the degrees of the vertices in the work queue, within their row
+ * bounds, to `total`.
+ */
+inline void frontierEdgesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *total)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int) {
+        EdgeId sum = 0;
+        for (size_t pos = begin; pos < end; pos++) {
+            VertexId v = workqueue[pos];
+            sum += rowEnds[v] - rowStarts[v];
+        }
+        atomicAdd(total, sum);
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * Writes the degrees, within their row bounds, of `sampleCount` vertices
+ * taken at even intervals of the work queue.
+ */
+inline void sampleDegreesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *samples,
+    VertexId        sampleCount)
+{
+    for (VertexId i = 0; i < sampleCount; i++) {
+        VertexId v = workqueue[i * (*workqueueSize / sampleCount)];
+        samples[i] = rowEnds[v] - rowStarts[v];
+    }
+}
+
+/**
+ * With `UseScan` each chunk collects its output in a local queue and reserves
+ * space in the global queue once, like a CTA does with its shared queue.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F,
+         bool UseScan>
+void vertexFilterKernel(
+    const Word  *workset,
+    VertexId     worksetsize,
+    VertexValue *vertexValues,
+    AccumValue  *accumulators,
+    VertexId    *workqueue,
+    VertexId    *workqueueSize,
+    F f)
+{
+    ThreadPool::get().parallelFor(worksetsize,
+    [&](size_t begin, size_t end, int) {
+        if (UseScan) {
+            std::vector<VertexId> localQueue;
+            for (VertexId v = begin; v < end; v++) {
+                if (bitmap::get(workset, v) && f.cond(vertexValues[v], accumulators[v])) {
+                    f.update(vertexValues[v], accumulators[v]);
+                    localQueue.push_back(v);
+                }
+            }
+            if (localQueue.empty()) return;
+            VertexId pos = atomicAdd(workqueueSize, localQueue.size());
+            std::copy(localQueue.begin(), localQueue.end(), workqueue + pos);
+        } else {
+            for (VertexId v = begin; v < end; v++) {
+                if (!bitmap::get(workset, v)) continue;
+                if (f.cond(vertexValues[v], accumulators[v])) {
+                    f.update(vertexValues[v], accumulators[v]);
+                    VertexId pos = atomicAdd(workqueueSize, 1);
+                    workqueue[pos] = v;
+                }
+            }
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+
+/** `vertexFilterKernel` over the vertices of a work queue. */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+void vertexFilterQueueKernel(
+    const VertexId *srcQueue,
+    const VertexId *srcQueueSize,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    VertexId       *workqueue,
+    VertexId       *workqueueSize,
+    F f)
+{
+    ThreadPool::get().parallelFor(*srcQueueSize,
+    [&](size_t begin, size_t end, int) {
+        std::vector<VertexId> localQueue;
+        for (size_t pos = begin; pos < end; pos++) {
+            VertexId v = srcQueue[pos];
+            if (f.cond(vertexValues[v], accumulators[v])) {
+                f.update(vertexValues[v], accumulators[v]);
+                localQueue.push_back(v);
+            }
+        }
+        flushQueue(localQueue, workqueue, workqueueSize);
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * sparse -> sparse
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+void edgeMapKernel(
+    const Word     *workset,
+    VertexId       worksetsize,
+    const EdgeId   *vertices,
+    const VertexId *outgoingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue      *edgeValues,
+    F f)
+{
+    ThreadPool::get().parallelFor(worksetsize,
+    [&](size_t begin, size_t end, int wid) {
+        for (VertexId srcId = begin; srcId < end; srcId++) {
+            if (!bitmap::get(workset, srcId)) continue;
+
+            EdgeId start = vertices[srcId];
+            EdgeId last = vertices[srcId + 1];
+            EdgeId outdegree = last - start;
+            VertexValue srcValue = vertexValues[srcId];
+
+            for (EdgeId e = start; e < last; e++) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                VertexId dstId = outgoingEdges[e];
+                reduceAccumulator(accumulators, hubs, dstId, accum, wid, f);
+            }
+        }
+    }, HOST_VERTEX_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+
+/**
+ * `edgeMapKernel` over the gap-encoded adjacency.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+void edgeMapCompressedKernel(
+    const Word          *workset,
+    VertexId             worksetsize,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    F f)
+{
+    ThreadPool::get().parallelFor(worksetsize,
+    [&](size_t begin, size_t end, int wid) {
+        for (VertexId srcId = begin; srcId < end; srcId++) {
+            if (!bitmap::get(workset, srcId)) continue;
+
+            EdgeId start = vertices[srcId];
+            EdgeId outdegree = vertices[srcId + 1] - start;
+            if (outdegree == 0) continue;
+            VertexValue srcValue = vertexValues[srcId];
+
+            const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+            EdgeId blocks = compressed::numBlocks(outdegree);
+            for (EdgeId b = 0; b < blocks; b++) {
+                compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+                EdgeId e = start + b * COMPRESSED_BLOCK_SIZE;
+                EdgeId last = std::min(e + COMPRESSED_BLOCK_SIZE, start + outdegree);
+                while (true) {
+                    AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                    reduceAccumulator(accumulators, hubs, decoder.dst, accum, wid, f);
+                    if (++e == last) break;
+                    decoder.next();
+                }
+            }
+        }
+    }, HOST_VERTEX_GRAIN);
+    combineHubs(accumulators, hubs, f);
+}
+
+/**
+ * Pulls over the incoming edges. Every destination is reduced by a single
+ * worker, in the order of its in-neighbors.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+void edgeMapPullKernel(
+    const Word     *workset,
+    VertexId        vertexCount,
+    const EdgeId   *vertices,
+    const EdgeId   *dstVertices,
+    const VertexId *incomingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    EdgeValue      *incomingEdgeValues,
+    AccumValue      init,
+    F f)
+{
+    ThreadPool::get().parallelFor(vertexCount,
+    [&](size_t begin, size_t end, int) {
+        for (VertexId dstId = begin; dstId < end; dstId++) {
+            EdgeId start = dstVertices[dstId];
+            EdgeId last = dstVertices[dstId + 1];
+            AccumValue accum = init;
+
+            for (EdgeId e = start; e < last; e++) {
+                VertexId srcId = incomingEdges[e];
+                if (!bitmap::get(workset, srcId)) continue;
+                EdgeId outdegree = vertices[srcId + 1] - vertices[srcId];
+                f.combine(accum, f.gather(vertexValues[srcId], outdegree,
+                                          incomingEdgeValues[e]));
+            }
+            accumulators[dstId] = accum;
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * Computes what each active source contributes to all its out-neighbors,
+ * for edge values that carry no data and thus can not change the gather.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+void gatherSourcesKernel(
+    const Word   *workset,
+    VertexId      vertexCount,
+    const EdgeId *vertices,
+    VertexValue  *vertexValues,
+    AccumValue   *contributions,
+    F f)
+{
+    ThreadPool::get().parallelFor(vertexCount,
+    [&](size_t begin, size_t end, int) {
+        for (VertexId v = begin; v < end; v++) {
+            if (!bitmap::get(workset, v)) continue;
+            EdgeId outdegree = vertices[v + 1] - vertices[v];
+            contributions[v] = f.gather(vertexValues[v], outdegree, EdgeValue());
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * `edgeMapPullKernel` over the contributions of the sources, which saves
+ * the reads of the source values and degrees on every edge.
+ */
+template<typename AccumValue,
+         typename F>
+void edgeMapPullGatheredKernel(
+    const Word       *workset,
+    VertexId          vertexCount,
+    const EdgeId     *dstVertices,
+    const VertexId   *incomingEdges,
+    const AccumValue *contributions,
+    AccumValue       *accumulators,
+    AccumValue        init,
+    F f)
+{
+    ThreadPool::get().parallelFor(vertexCount,
+    [&](size_t begin, size_t end, int) {
+        for (VertexId dstId = begin; dstId < end; dstId++) {
+            EdgeId start = dstVertices[dstId];
+            EdgeId last = dstVertices[dstId + 1];
+            AccumValue accum = init;
+
+            for (EdgeId e = start; e < last; e++) {
+                VertexId srcId = incomingEdges[e];
+                if (bitmap::get(workset, srcId)) f.combine(accum, contributions[srcId]);
+            }
+            accumulators[dstId] = accum;
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * Number of partial results of a vertex reduction: one per worker, and at
+ * least `REDUCE_BLOCKS` like the GPU backend. The pool is sized once, so
+ * the partials reserved for the first reduction fit all the later ones.
+ */
+inline size_t reducePartialCount() {
+    return std::max<size_t>(REDUCE_BLOCKS, ThreadPool::get().size());
+}
+
+/**
+ * One fused iteration over the vertices of `workset`: each pulls the
+ * contributions of its in-neighbors in `workset`, applies `vertexF` to its
+ * value with them, and folds `reduceF.map` of the new value into the
+ * partial result of the worker. The accumulators are not written.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EF,
+         typename VF,
+         typename RF>
+void superstepPullKernel(
+    const Word       *workset,
+    VertexId          vertexCount,
+    const EdgeId     *dstVertices,
+    const VertexId   *incomingEdges,
+    const AccumValue *contributions,
+    VertexValue      *vertexValues,
+    AccumValue       *partials,
+    AccumValue        gatherInit,
+    AccumValue        reduceInit,
+    EF edgeF,
+    VF vertexF,
+    RF reduceF)
+{
+    std::fill(partials, partials + reducePartialCount(), reduceInit);
+    ThreadPool::get().parallelFor(vertexCount,
+    [&](size_t begin, size_t end, int wid) {
+        AccumValue x = reduceInit;
+        for (VertexId dstId = begin; dstId < end; dstId++) {
+            if (!bitmap::get(workset, dstId)) continue;
+            EdgeId start = dstVertices[dstId];
+            EdgeId last = dstVertices[dstId + 1];
+            AccumValue accum = gatherInit;
+
+            for (EdgeId e = start; e < last; e++) {
+                VertexId srcId = incomingEdges[e];
+                if (bitmap::get(workset, srcId)) edgeF.combine(accum, contributions[srcId]);
+            }
+            vertexF(vertexValues[dstId], accum);
+            reduceF.combine(x, reduceF.map(vertexValues[dstId]));
+        }
+        reduceF.combine(partials[wid], x);
+    }, HOST_VERTEX_GRAIN);
+}
+
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+void vertexMapSparseKernel(
+    const Word   *workset,
+    VertexId      worksetsize,
+    VertexValue  *vertexValues,
+    AccumValue   *accumulators,
+    F f)
+{
+    ThreadPool::get().parallelFor(worksetsize,
+    [&](size_t begin, size_t end, int) {
+        for (VertexId v = begin; v < end; v++) {
+            if (!bitmap::get(workset, v)) continue;
+            f(vertexValues[v], accumulators[v]);
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+void vertexMapDenseKernel(
+    const VertexId  *workqueue,
+    const VertexId  *workqueueSize,
+    VertexValue     *vertexValues,
+    AccumValue      *accumulators,
+    F f)
+{
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int) {
+        for (size_t pos = begin; pos < end; pos++) {
+            VertexId v = workqueue[pos];
+            f(vertexValues[v], accumulators[v]);
+        }
+    }, HOST_VERTEX_GRAIN);
+}
+
+/**
+ * The first pass of the vertex reduction: every worker combines the mapped
+ * values of its chunks into `partials[workerId]`. The unused partials are
+ * left to `init`, see `reducePartialCount`.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+void vertexReduceSparseKernel(
+    const Word        *workset,
+    VertexId           worksetsize,
+    const VertexValue *vertexValues,
+    AccumValue        *partials,
+    AccumValue         init,
+    F f)
+{
+    std::fill(partials, partials + reducePartialCount(), init);
+    ThreadPool::get().parallelFor(worksetsize,
+    [&](size_t begin, size_t end, int wid) {
+        AccumValue x = init;
+        for (size_t v = begin; v < end; v++) {
+            if (bitmap::get(workset, v)) f.combine(x, f.map(vertexValues[v]));
+        }
+        f.combine(partials[wid], x);
+    }, HOST_VERTEX_GRAIN);
+}
+
+/** `vertexReduceSparseKernel` over a work queue. */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+void vertexReduceDenseKernel(
+    const VertexId    *workqueue,
+    const VertexId    *workqueueSize,
+    const VertexValue *vertexValues,
+    AccumValue        *partials,
+    AccumValue         init,
+    F f)
+{
+    std::fill(partials, partials + reducePartialCount(), init);
+    ThreadPool::get().parallelFor(*workqueueSize,
+    [&](size_t begin, size_t end, int wid) {
+        AccumValue x = init;
+        for (size_t pos = begin; pos < end; pos++) {
+            f.combine(x, f.map(vertexValues[workqueue[pos]]));
+        }
+        f.combine(partials[wid], x);
+    }, HOST_VERTEX_GRAIN);
+}
+
+/** The second pass of the vertex reduction. */
+template<typename AccumValue,
+         typename F>
+void combinePartialsKernel(
+    const AccumValue *partials,
+    AccumValue       *result,
+    AccumValue        init,
+    F f)
+{
+    AccumValue x = init;
+    for (size_t i = 0; i < reducePartialCount(); i++) f.combine(x, partials[i]);
+    *result = x;
+}
+
+#endif  // OLIVER_HOST_H
@@ -35,40 +35,125 @@
 #define OLIVER_KERNEL_H
 
 #include "common.h"
+#include "bitmap.h"
+#include "compressedAdjacency.h"
 
 
 
+/**
+ * Activates `v` in the output of an edge expansion: sets its bit in `flags`,
+ * or with `ToQueue` stamps it instead. The first to stamp `v` with the
+ * `stamp` of the current step queues it.
+ */
+template<bool ToQueue>
+__device__
+inline void activate(Word *flags, int *stamps, VertexId v, int stamp,
+                     VertexId *queue, VertexId *queueSize) {
+    if (!ToQueue) {
+        bitmap::set(flags, v);
+    } else if (stamps[v] != stamp && atomicExch(&stamps[v], stamp) != stamp) {
+        queue[atomicAdd(queueSize, (VertexId) 1)] = v;
+    }
+}
+
+/**
+ * Sets up the hub slots of the block, `slots` and `touched` in shared
+ * memory. Every thread of the block must call it.
+ */
+template<typename AccumValue>
+__device__
+inline void openHubs(const HubAccumulators<AccumValue> &hubs,
+                     AccumValue *slots, int *touched) {
+    for (int h = threadIdx.x; h < hubs.count; h += blockDim.x) {
+        slots[h] = hubs.init;
+        touched[h] = 0;
+    }
+    __syncthreads();
+}
+
+/**
+ * Reduces `accum` into the accumulator of `v`, or into the slot of the
+ * block if `v` is a hub, where only the threads of the block contend.
+ */
+template<typename AccumValue, typename F>
+__device__
+inline void reduceAccumulator(AccumValue *accumulators,
+                              const HubAccumulators<AccumValue> &hubs,
+                              VertexId v, AccumValue accum,
+                              AccumValue *slots, int *touched, F &f) {
+    if (hubs.count == 0 || !bitmap::get(hubs.flags, v)) {
+        f.reduce(accumulators[v], accum);
+        return;
+    }
+    int h = hubs.slots[v];
+    f.reduce(slots[h], accum);
+    touched[h] = 1;
+}
+
+/**
+ * Reduces the slots the block has touched into the accumulators of the
+ * hubs, one atomic per hub and block. Every thread of the block must call
+ * it.
+ */
+template<typename AccumValue, typename F>
+__device__
+inline void closeHubs(AccumValue *accumulators,
+                      const HubAccumulators<AccumValue> &hubs,
+                      AccumValue *slots, int *touched, F &f) {
+    __syncthreads();
+    for (int h = threadIdx.x; h < hubs.count; h += blockDim.x) {
+        if (touched[h]) f.reduce(accumulators[hubs.vertices[h]], slots[h]);
+    }
+}
 
 /**
  * The CUDA kernel for expanding vertices in the work queue.
+ *
+ * The edges of vertex `v` are those in [`rowStarts[v]`, `rowEnds[v]`), which
+ * is its whole row unless the engine scans a slice of it, see `RowSlice`.
+ * `f.gather` is given the number of those edges as the out-degree.
+ *
+ * The destinations are flagged in `flags`. With `ToQueue` they are
+ * appended to `outQueue` instead, once each, see `activate`.
  */
 template<typename VertexValue,
          typename AccumValue,
          typename EdgeValue,
          typename F,
-         int GroupSize>
+         int GroupSize,
+         bool ToQueue>
 __global__
 void edgeFilterKernel(
     const VertexId *workqueue,
     const VertexId *workqueueSize,
-    const EdgeId   *vertices,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
     const VertexId *outgoingEdges,
     VertexValue    *vertexValues,
     AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
     EdgeValue      *edgeValues,
-    int            *workset,
+    Word           *flags,
+
+    int            *stamps,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize,
+    int             stamp,
     F f)
 {
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
 
     int group_off = THREAD_INDEX % GroupSize;
-    int group_idx = THREAD_INDEX / GroupSize;
-    int group_num = NUM_THREADS / GroupSize;
+    VertexId group_idx = THREAD_INDEX / GroupSize;
+    VertexId group_num = NUM_THREADS / GroupSize;
 
-    for (int g = group_idx; g < *workqueueSize; g += group_num) {
+    for (VertexId g = group_idx; g < *workqueueSize; g += group_num) {
         VertexId srcId = workqueue[g];
 
-        EdgeId start = vertices[srcId];
-        EdgeId end = vertices[srcId + 1];
+        EdgeId start = rowStarts[srcId];
+        EdgeId end = rowEnds[srcId];
         EdgeId outdegree = end - start;
         VertexValue srcValue = vertexValues[srcId];
 
@@ -76,9 +161,440 @@ void edgeFilterKernel(
             // Edge level parallelism, which is exploited by SIMD lanes
             AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
             VertexId dstId = outgoingEdges[e];
-            f.reduce(accumulators[dstId], accum);
-            workset[dstId] = 1;
+            reduceAccumulator(accumulators, hubs, dstId, accum, hubSlots, hubTouched, f);
+            activate<ToQueue>(flags, stamps, dstId, stamp, outQueue, outQueueSize);
+        }
+    }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
+}
+
+/**
+ * `edgeFilterKernel` over the gap-encoded adjacency. The lanes of a group
+ * split a row by its blocks, each of which is decoded independently.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         int GroupSize,
+         bool ToQueue>
+__global__
+void edgeFilterCompressedKernel(
+    const VertexId      *workqueue,
+    const VertexId      *workqueueSize,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    Word                *flags,
+
+    int                 *stamps,
+    VertexId            *outQueue,
+    VertexId            *outQueueSize,
+    int                  stamp,
+    F f)
+{
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
+
+    int group_off = THREAD_INDEX % GroupSize;
+    VertexId group_idx = THREAD_INDEX / GroupSize;
+    VertexId group_num = NUM_THREADS / GroupSize;
+
+    for (VertexId g = group_idx; g < *workqueueSize; g += group_num) {
+        VertexId srcId = workqueue[g];
+
+        EdgeId start = vertices[srcId];
+        EdgeId outdegree = vertices[srcId + 1] - start;
+        VertexValue srcValue = vertexValues[srcId];
+
+        const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+        EdgeId blocks = compressed::numBlocks(outdegree);
+
+        for (EdgeId b = group_off; b < blocks; b += GroupSize) {
+            compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+            EdgeId e = start + b * COMPRESSED_BLOCK_SIZE;
+            EdgeId last = (e + COMPRESSED_BLOCK_SIZE < start + outdegree) ?
+                          e + COMPRESSED_BLOCK_SIZE : start + outdegree;
+            while (true) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                reduceAccumulator(accumulators, hubs, decoder.dst, accum, hubSlots, hubTouched, f);
+                activate<ToQueue>(flags, stamps, decoder.dst, stamp, outQueue, outQueueSize);
+                if (++e == last) break;
+                decoder.next();
+            }
+        }
+    }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
+}
+
+/**
+ * Writes the degree of every vertex in the work queue, within its row
+ * bounds, followed by a 0 which the exclusive scan turns into the total.
+ */
+__global__
+void frontierDegreesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *degrees)
+{
+    VertexId size = *workqueueSize;
+    for (VertexId pos = THREAD_INDEX; pos < size; pos += NUM_THREADS) {
+        VertexId v = workqueue[pos];
+        degrees[pos] = rowEnds[v] - rowStarts[v];
+    }
+    if (THREAD_INDEX == 0) degrees[size] = 0;
+}
+
+/**
+ * Exclusive scan of the `*count + 1` entries of `data`, by a single CTA of
+ * `MAX_THREADS_PER_BLOCK` threads. Each thread scans a contiguous segment,
+ * after the sums of the segments are scanned in shared memory.
+ */
+__global__
+void frontierScanKernel(
+    EdgeId         *data,
+    const VertexId *count)
+{
+    __shared__ EdgeId sums[MAX_THREADS_PER_BLOCK];
+    VertexId n = *count + 1;
+    VertexId per = (n + blockDim.x - 1) / blockDim.x;
+    VertexId begin = threadIdx.x * per < n ? threadIdx.x * per : n;
+    VertexId end = begin + per < n ? begin + per : n;
+
+    EdgeId sum = 0;
+    for (VertexId i = begin; i < end; i++) sum += data[i];
+    sums[threadIdx.x] = sum;
+    __syncthreads();
+
+    for (int offset = 1; offset < blockDim.x; offset <<= 1) {
+        EdgeId x = threadIdx.x >= offset ? sums[threadIdx.x - offset] : 0;
+        __syncthreads();
+        sums[threadIdx.x] += x;
+        __syncthreads();
+    }
+
+    EdgeId running = threadIdx.x > 0 ? sums[threadIdx.x - 1] : 0;
+    for (VertexId i = begin; i < end; i++) {
+        EdgeId x = data[i];
+        data[i] = running;
+        running += x;
+    }
+}
+
+/**
+ * Finds the position in the work queue of the vertex that owns rank `r` in
+ * the concatenated edges of the frontier. `offsets` is the scan of the
+ * degrees.
+ */
+__device__
+inline VertexId frontierOwner(const EdgeId *offsets, VertexId size, EdgeId r) {
+    VertexId low = 0, high = size;
+    while (low < high) {
+        VertexId mid = (low + high + 1) / 2;
+        if (offsets[mid] <= r) low = mid; else high = mid - 1;
+    }
+    return low;
+}
+
+/**
+ * `edgeFilterKernel` with the edges of the frontier split evenly between
+ * the threads, whatever the degrees: a thread starts at the vertex owning
+ * its first edge, found by a binary search in the scan of the degrees, and
+ * walks the adjacency lists from there. A hub is expanded by many threads.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         bool ToQueue>
+__global__
+void edgeFilterBalancedKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *offsets,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    const VertexId *outgoingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue      *edgeValues,
+    Word           *flags,
+
+    int            *stamps,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize,
+    int             stamp,
+    F f)
+{
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
+
+    VertexId size = *workqueueSize;
+    EdgeId total = offsets[size];
+    EdgeId per = (total + NUM_THREADS - 1) / NUM_THREADS;
+    EdgeId begin = THREAD_INDEX * per;
+    EdgeId end = begin + per < total ? begin + per : total;
+
+    for (VertexId g = frontierOwner(offsets, size, begin); begin < end; g++) {
+        EdgeId stop = offsets[g + 1] < end ? offsets[g + 1] : end;
+        if (stop == begin) continue;
+        VertexId srcId = workqueue[g];
+        EdgeId start = rowStarts[srcId];
+        EdgeId outdegree = rowEnds[srcId] - start;
+        VertexValue srcValue = vertexValues[srcId];
+
+        EdgeId last = start + (stop - offsets[g]);
+        for (EdgeId e = start + (begin - offsets[g]); e < last; e++) {
+            AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+            VertexId dstId = outgoingEdges[e];
+            reduceAccumulator(accumulators, hubs, dstId, accum, hubSlots, hubTouched, f);
+            activate<ToQueue>(flags, stamps, dstId, stamp, outQueue, outQueueSize);
         }
+        begin = stop;
+    }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
+}
+
+/**
+ * `edgeFilterBalancedKernel` over the gap-encoded adjacency. A thread
+ * starting in the middle of a row decodes from the beginning of the block
+ * of its first edge.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F,
+         bool ToQueue>
+__global__
+void edgeFilterBalancedCompressedKernel(
+    const VertexId      *workqueue,
+    const VertexId      *workqueueSize,
+    const EdgeId        *offsets,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    Word                *flags,
+
+    int                 *stamps,
+    VertexId            *outQueue,
+    VertexId            *outQueueSize,
+    int                  stamp,
+    F f)
+{
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
+
+    VertexId size = *workqueueSize;
+    EdgeId total = offsets[size];
+    EdgeId per = (total + NUM_THREADS - 1) / NUM_THREADS;
+    EdgeId begin = THREAD_INDEX * per;
+    EdgeId end = begin + per < total ? begin + per : total;
+
+    for (VertexId g = frontierOwner(offsets, size, begin); begin < end; g++) {
+        EdgeId stop = offsets[g + 1] < end ? offsets[g + 1] : end;
+        if (stop == begin) continue;
+        VertexId srcId = workqueue[g];
+        EdgeId start = vertices[srcId];
+        EdgeId outdegree = vertices[srcId + 1] - start;
+        VertexValue srcValue = vertexValues[srcId];
+
+        const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+        EdgeId blocks = compressed::numBlocks(outdegree);
+        EdgeId i = begin - offsets[g];
+        EdgeId last = stop - offsets[g];
+        while (i < last) {
+            EdgeId b = i / COMPRESSED_BLOCK_SIZE;
+            compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+            for (EdgeId skip = b * COMPRESSED_BLOCK_SIZE; skip < i; skip++) {
+                decoder.next();
+            }
+            EdgeId blockLast = (b + 1) * COMPRESSED_BLOCK_SIZE < last ?
+                               (b + 1) * COMPRESSED_BLOCK_SIZE : last;
+            while (true) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[start + i]);
+                reduceAccumulator(accumulators, hubs, decoder.dst, accum, hubSlots, hubTouched, f);
+                activate<ToQueue>(flags, stamps, decoder.dst, stamp, outQueue, outQueueSize);
+                if (++i == blockLast) break;
+                decoder.next();
+            }
+        }
+        begin = stop;
+    }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
+}
+
+/**
+ * The bottom-up step of a traversal. Every vertex still satisfying
+ * `f.cond` looks through its in-edges for a source in `frontier`, and
+ * stops at the first one it finds.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+__global__
+void edgeFilterPullKernel(
+    const Word     *frontier,
+    VertexId        vertexCount,
+    const EdgeId   *vertices,
+    const EdgeId   *dstVertices,
+    const VertexId *incomingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    EdgeValue      *incomingEdgeValues,
+    Word           *workset,
+    F f)
+{
+    for (VertexId dstId = THREAD_INDEX; dstId < vertexCount; dstId += NUM_THREADS) {
+        if (!f.cond(vertexValues[dstId])) continue;
+
+        EdgeId last = dstVertices[dstId + 1];
+        for (EdgeId e = dstVertices[dstId]; e < last; e++) {
+            VertexId srcId = incomingEdges[e];
+            if (!bitmap::get(frontier, srcId)) continue;
+            EdgeId outdegree = vertices[srcId + 1] - vertices[srcId];
+            f.reduce(accumulators[dstId], f.gather(vertexValues[srcId], outdegree,
+                                                   incomingEdgeValues[e]));
+            bitmap::set(workset, dstId);
+            break;
+        }
+    }
+}
+
+/**
+ * Sets the flag of every vertex in the work queue to `value`, or any other
+ * per-vertex element, e.g. its accumulator.
+ */
+template<typename T>
+__global__
+void markQueueKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    T              *flags,
+    T               value)
+{
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        flags[workqueue[pos]] = value;
+    }
+}
+
+/** Copies the work queue and its size. */
+__global__
+void copyQueueKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    VertexId       *outQueue,
+    VertexId       *outQueueSize)
+{
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        outQueue[pos] = workqueue[pos];
+    }
+    if (THREAD_INDEX == 0) *outQueueSize = *workqueueSize;
+}
+
+/** Sets the bit of every vertex in the work queue. */
+__global__
+void queueToFlagsKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    Word           *flags)
+{
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        bitmap::set(flags, workqueue[pos]);
+    }
+}
+
+/**
+ * Appends the flagged vertices to the work queue, in no particular order.
+ * Each thread takes a word, and reserves room for all its bits at once.
+ */
+__global__
+void flagsToQueueKernel(
+    const Word *flags,
+    VertexId    flagCount,
+    VertexId   *workqueue,
+    VertexId   *workqueueSize)
+{
+    size_t words = bitmap::wordCount(flagCount);
+    for (size_t w = THREAD_INDEX; w < words; w += NUM_THREADS) {
+        Word bits = flags[w];
+        if (bits == 0) continue;
+        VertexId pos = atomicAdd(workqueueSize, (VertexId) bitmap::popcount(bits));
+        for (; bits != 0; bits &= bits - 1) {
+            workqueue[pos++] = w * bitmap::WORD_BITS + bitmap::lowestBit(bits);
+        }
+    }
+}
+
+/** Adds the number of set flags to `count`, a word at a time. */
+__global__
+void countFlagsKernel(
+    const Word *flags,
+    VertexId    flagCount,
+    VertexId   *count)
+{
+    size_t words = bitmap::wordCount(flagCount);
+    VertexId sum = 0;
+    for (size_t w = THREAD_INDEX; w < words; w += NUM_THREADS) {
+        sum += bitmap::popcount(flags[w]);
+    }
+    if (sum > 0) atomicAdd(count, sum);
+}
+
+/**
+ * Adds the degrees of the vertices in the work queue, within their row
+ * bounds, to `total`.
+ */
+__global__
+void frontierEdgesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *total)
+{
+    EdgeId sum = 0;
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        VertexId v = workqueue[pos];
+        sum += rowEnds[v] - rowStarts[v];
+    }
+    if (sum > 0) atomicAdd(total, sum);
+}
+
+/**
+ * Writes the degrees, within their row bounds, of `sampleCount` vertices
+ * taken at even intervals of the work queue.
+ */
+__global__
+void sampleDegreesKernel(
+    const VertexId *workqueue,
+    const VertexId *workqueueSize,
+    const EdgeId   *rowStarts,
+    const EdgeId   *rowEnds,
+    EdgeId         *samples,
+    VertexId        sampleCount)
+{
+    for (VertexId i = THREAD_INDEX; i < sampleCount; i += NUM_THREADS) {
+        VertexId v = workqueue[i * (*workqueueSize / sampleCount)];
+        samples[i] = rowEnds[v] - rowStarts[v];
     }
 }
 
@@ -88,7 +604,7 @@ template<typename VertexValue,
          bool UseScan>
 __global__
 void vertexFilterKernel(
-    const int   *workset,
+    const Word  *workset,
     VertexId     worksetsize,
     VertexValue *vertexValues,
     AccumValue  *accumulators,
@@ -96,51 +612,75 @@ void vertexFilterKernel(
     VertexId    *workqueueSize,
     F f)
 {
-    int v = THREAD_INDEX;
-    if (v >= worksetsize) return;
-    
-
     if (UseScan) {
         __shared__ VertexId local_queue[1200];       
-        __shared__ VertexId local_queue_size;               
+        __shared__ int      local_queue_size;               
         __shared__ VertexId global_pos;   // shared by all CTA threads
 
-        if (threadIdx.x == 0) local_queue_size = 0;
-        __syncthreads();
+        // All threads of the CTA take the same number of trips, so that
+        // they all reach the barriers.
+        for (VertexId base = BLOCK_INDEX * blockDim.x; base < worksetsize;
+                base += NUM_THREADS) {
+            VertexId v = base + threadIdx.x;
 
+            if (threadIdx.x == 0) local_queue_size = 0;
+            __syncthreads();
 
-        if (workset[v] && f.cond(vertexValues[v], v)) {
-            f.update(vertexValues[v], accumulators[v]);
-            VertexId pos = atomicAdd((int *)&local_queue_size, 1);
-            local_queue[pos] = v;
-            // printf("push %d to local queue at pos:%d \n", v, pos);
+            if (v < worksetsize && bitmap::get(workset, v) &&
+                    f.cond(vertexValues[v], accumulators[v])) {
+                f.update(vertexValues[v], accumulators[v]);
+                int pos = atomicAdd(&local_queue_size, 1);
+                local_queue[pos] = v;
+            }
+            __syncthreads();
 
-        }
-        __syncthreads();
+            if (threadIdx.x == 0)
+                global_pos = atomicAdd(workqueueSize, (VertexId) local_queue_size);
+            __syncthreads();
 
-    
-        if (threadIdx.x == 0)
-            global_pos = atomicAdd(workqueueSize, local_queue_size);
-        __syncthreads();
+            // CTA copys its queue
+            for (int i = threadIdx.x; i < local_queue_size; i += blockDim.x) {
+                workqueue[global_pos+i] = local_queue[i];
+            }
+            __syncthreads();
+        }
 
-        // CTA copys its queue
-        for (int i = threadIdx.x; i < local_queue_size; i += blockDim.x) {
-            workqueue[global_pos+i] = local_queue[i];
-            //printf("push %d to next queue at pos:%d  \n", local_queue[i], pos+i);
+    } else {
+        for (VertexId v = THREAD_INDEX; v < worksetsize; v += NUM_THREADS) {
+            if (!bitmap::get(workset, v)) continue;
+            if (f.cond(vertexValues[v], accumulators[v])) {
+                f.update(vertexValues[v], accumulators[v]);
+                VertexId pos = atomicAdd(workqueueSize, (VertexId) 1);
+                workqueue[pos] = v;
+            }
         }
+    }
+}
 
 
-    } else {
-        if (!workset[v]) return;
-        if (f.cond(vertexValues[v], v)) {
+/** `vertexFilterKernel` over the vertices of a work queue. */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+__global__
+void vertexFilterQueueKernel(
+    const VertexId *srcQueue,
+    const VertexId *srcQueueSize,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    VertexId       *workqueue,
+    VertexId       *workqueueSize,
+    F f)
+{
+    for (VertexId pos = THREAD_INDEX; pos < *srcQueueSize; pos += NUM_THREADS) {
+        VertexId v = srcQueue[pos];
+        if (f.cond(vertexValues[v], accumulators[v])) {
             f.update(vertexValues[v], accumulators[v]);
-            VertexId pos = atomicAdd(workqueueSize, 1);
-            workqueue[pos] = v;
-        }   
+            workqueue[atomicAdd(workqueueSize, (VertexId) 1)] = v;
+        }
     }
 }
 
-
 /**
  * The vertex map kernel.
  * sparse -> sparse
@@ -151,33 +691,248 @@ template<typename VertexValue,
          typename F>
 __global__
 void edgeMapKernel(
-    const int      *workset,
+    const Word     *workset,
     VertexId       worksetsize,
     const EdgeId   *vertices,
     const VertexId *outgoingEdges,
     VertexValue    *vertexValues,
     AccumValue     *accumulators,
+    HubAccumulators<AccumValue> hubs,
     EdgeValue      *edgeValues,
     F f)
 {
-    VertexId srcId = THREAD_INDEX;
-    if (srcId >= worksetsize) return;
-    if (!workset[srcId]) return;
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
 
-    EdgeId start = vertices[srcId];
-    EdgeId end = vertices[srcId + 1];
-    EdgeId outdegree = end - start;
-    VertexValue srcValue = vertexValues[srcId];
+    for (VertexId srcId = THREAD_INDEX; srcId < worksetsize; srcId += NUM_THREADS) {
+        if (!bitmap::get(workset, srcId)) continue;
 
-    for (EdgeId e = start; e < end; e ++) {
-        // Edge level parallelism, which is exploited by SIMD lanes
-        AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
-        VertexId dstId = outgoingEdges[e];
-        f.reduce(accumulators[dstId], accum);
+        EdgeId start = vertices[srcId];
+        EdgeId end = vertices[srcId + 1];
+        EdgeId outdegree = end - start;
+        VertexValue srcValue = vertexValues[srcId];
+
+        for (EdgeId e = start; e < end; e ++) {
+            // Edge level parallelism, which is exploited by SIMD lanes
+            AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+            VertexId dstId = outgoingEdges[e];
+            reduceAccumulator(accumulators, hubs, dstId, accum, hubSlots, hubTouched, f);
+        }
     }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
 }
 
 
+/**
+ * `edgeMapKernel` over the gap-encoded adjacency.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+__global__
+void edgeMapCompressedKernel(
+    const Word          *workset,
+    VertexId             worksetsize,
+    const EdgeId        *vertices,
+    const ByteOffset    *compressedOffsets,
+    const unsigned char *compressedEdges,
+    VertexValue         *vertexValues,
+    AccumValue          *accumulators,
+    HubAccumulators<AccumValue> hubs,
+    EdgeValue           *edgeValues,
+    F f)
+{
+    __shared__ AccumValue hubSlots[MAX_HUBS];
+    __shared__ int hubTouched[MAX_HUBS];
+    openHubs(hubs, hubSlots, hubTouched);
+
+    for (VertexId srcId = THREAD_INDEX; srcId < worksetsize; srcId += NUM_THREADS) {
+        if (!bitmap::get(workset, srcId)) continue;
+
+        EdgeId start = vertices[srcId];
+        EdgeId outdegree = vertices[srcId + 1] - start;
+        if (outdegree == 0) continue;
+        VertexValue srcValue = vertexValues[srcId];
+
+        const unsigned char *row = compressedEdges + compressedOffsets[srcId];
+        EdgeId blocks = compressed::numBlocks(outdegree);
+        for (EdgeId b = 0; b < blocks; b++) {
+            compressed::BlockDecoder decoder(compressed::blockStart(row, blocks, b), srcId);
+            EdgeId e = start + b * COMPRESSED_BLOCK_SIZE;
+            EdgeId last = (e + COMPRESSED_BLOCK_SIZE < start + outdegree) ?
+                          e + COMPRESSED_BLOCK_SIZE : start + outdegree;
+            while (true) {
+                AccumValue accum = f.gather(srcValue, outdegree, edgeValues[e]);
+                reduceAccumulator(accumulators, hubs, decoder.dst, accum, hubSlots, hubTouched, f);
+                if (++e == last) break;
+                decoder.next();
+            }
+        }
+    }
+
+    closeHubs(accumulators, hubs, hubSlots, hubTouched, f);
+}
+
+/**
+ * The pull-mode edge map kernel. Each thread reduces the incoming edges of
+ * one destination into a register and writes its accumulator once.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+__global__
+void edgeMapPullKernel(
+    const Word     *workset,
+    VertexId        vertexCount,
+    const EdgeId   *vertices,
+    const EdgeId   *dstVertices,
+    const VertexId *incomingEdges,
+    VertexValue    *vertexValues,
+    AccumValue     *accumulators,
+    EdgeValue      *incomingEdgeValues,
+    AccumValue      init,
+    F f)
+{
+    for (VertexId dstId = THREAD_INDEX; dstId < vertexCount; dstId += NUM_THREADS) {
+        EdgeId start = dstVertices[dstId];
+        EdgeId last = dstVertices[dstId + 1];
+        AccumValue accum = init;
+
+        for (EdgeId e = start; e < last; e++) {
+            VertexId srcId = incomingEdges[e];
+            if (!bitmap::get(workset, srcId)) continue;
+            EdgeId outdegree = vertices[srcId + 1] - vertices[srcId];
+            f.combine(accum, f.gather(vertexValues[srcId], outdegree,
+                                      incomingEdgeValues[e]));
+        }
+        accumulators[dstId] = accum;
+    }
+}
+
+/**
+ * Computes what each active source contributes to all its out-neighbors,
+ * for edge values that carry no data and thus can not change the gather.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EdgeValue,
+         typename F>
+__global__
+void gatherSourcesKernel(
+    const Word   *workset,
+    VertexId      vertexCount,
+    const EdgeId *vertices,
+    VertexValue  *vertexValues,
+    AccumValue   *contributions,
+    F f)
+{
+    for (VertexId v = THREAD_INDEX; v < vertexCount; v += NUM_THREADS) {
+        if (!bitmap::get(workset, v)) continue;
+        EdgeId outdegree = vertices[v + 1] - vertices[v];
+        contributions[v] = f.gather(vertexValues[v], outdegree, EdgeValue());
+    }
+}
+
+/**
+ * `edgeMapPullKernel` over the contributions of the sources, which saves
+ * the reads of the source values and degrees on every edge.
+ */
+template<typename AccumValue,
+         typename F>
+__global__
+void edgeMapPullGatheredKernel(
+    const Word       *workset,
+    VertexId          vertexCount,
+    const EdgeId     *dstVertices,
+    const VertexId   *incomingEdges,
+    const AccumValue *contributions,
+    AccumValue       *accumulators,
+    AccumValue        init,
+    F f)
+{
+    for (VertexId dstId = THREAD_INDEX; dstId < vertexCount; dstId += NUM_THREADS) {
+        EdgeId start = dstVertices[dstId];
+        EdgeId last = dstVertices[dstId + 1];
+        AccumValue accum = init;
+
+        for (EdgeId e = start; e < last; e++) {
+            VertexId srcId = incomingEdges[e];
+            if (bitmap::get(workset, srcId)) f.combine(accum, contributions[srcId]);
+        }
+        accumulators[dstId] = accum;
+    }
+}
+
+/** Number of partial results of a vertex reduction, one per block. */
+inline size_t reducePartialCount() {
+    return REDUCE_BLOCKS;
+}
+
+/**
+ * Combines the values `x` of the threads of the block into `*out` with
+ * `f.combine`, as a tree. The block size must be a power of two.
+ */
+template<typename AccumValue,
+         typename F>
+__device__
+inline void combineBlock(AccumValue x, AccumValue *out, F &f) {
+    __shared__ AccumValue sums[MAX_THREADS_PER_BLOCK];
+    sums[threadIdx.x] = x;
+    __syncthreads();
+    for (int half = blockDim.x / 2; half > 0; half >>= 1) {
+        if (threadIdx.x < half) f.combine(sums[threadIdx.x], sums[threadIdx.x + half]);
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) *out = sums[0];
+}
+
+/**
+ * One fused iteration over the vertices of `workset`: each pulls the
+ * contributions of its in-neighbors in `workset` into a register, applies
+ * `vertexF` to its value with it, and folds `reduceF.map` of the new value
+ * into the partial result of its block. The accumulators are not written.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename EF,
+         typename VF,
+         typename RF>
+__global__
+void superstepPullKernel(
+    const Word       *workset,
+    VertexId          vertexCount,
+    const EdgeId     *dstVertices,
+    const VertexId   *incomingEdges,
+    const AccumValue *contributions,
+    VertexValue      *vertexValues,
+    AccumValue       *partials,
+    AccumValue        gatherInit,
+    AccumValue        reduceInit,
+    EF edgeF,
+    VF vertexF,
+    RF reduceF)
+{
+    AccumValue x = reduceInit;
+    for (VertexId dstId = THREAD_INDEX; dstId < vertexCount; dstId += NUM_THREADS) {
+        if (!bitmap::get(workset, dstId)) continue;
+        EdgeId start = dstVertices[dstId];
+        EdgeId last = dstVertices[dstId + 1];
+        AccumValue accum = gatherInit;
+
+        for (EdgeId e = start; e < last; e++) {
+            VertexId srcId = incomingEdges[e];
+            if (bitmap::get(workset, srcId)) edgeF.combine(accum, contributions[srcId]);
+        }
+        vertexF(vertexValues[dstId], accum);
+        reduceF.combine(x, reduceF.map(vertexValues[dstId]));
+    }
+    combineBlock(x, &partials[blockIdx.x], reduceF);
+}
+
 /**
  * The vertex map kernel.
  */
@@ -186,17 +941,16 @@ template<typename VertexValue,
          typename F>
 __global__
 void vertexMapSparseKernel(
-    const int    *workset,
+    const Word   *workset,
     VertexId      worksetsize,
     VertexValue  *vertexValues,
     AccumValue   *accumulators,
     F f)
 {
-    int v = THREAD_INDEX;
-    if (v >= worksetsize) return;
-    if (!workset[v]) return;
-
-    f(vertexValues[v], accumulators[v]);
+    for (VertexId v = THREAD_INDEX; v < worksetsize; v += NUM_THREADS) {
+        if (!bitmap::get(workset, v)) continue;
+        f(vertexValues[v], accumulators[v]);
+    }
 }
 
 
@@ -214,10 +968,70 @@ void vertexMapDenseKernel(
     AccumValue      *accumulators,
     F f)
 {
-    VertexId pos = THREAD_INDEX;
-    if (pos >= *workqueueSize) return;
-    VertexId v = workqueue[pos];
-    f(vertexValues[v], accumulators[v]);
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        VertexId v = workqueue[pos];
+        f(vertexValues[v], accumulators[v]);
+    }
+}
+
+/**
+ * The first pass of the vertex reduction: every block combines the mapped
+ * values of its vertices into `partials[blockIdx.x]`.
+ */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+__global__
+void vertexReduceSparseKernel(
+    const Word        *workset,
+    VertexId           worksetsize,
+    const VertexValue *vertexValues,
+    AccumValue        *partials,
+    AccumValue         init,
+    F f)
+{
+    AccumValue x = init;
+    for (VertexId v = THREAD_INDEX; v < worksetsize; v += NUM_THREADS) {
+        if (bitmap::get(workset, v)) f.combine(x, f.map(vertexValues[v]));
+    }
+    combineBlock(x, &partials[blockIdx.x], f);
+}
+
+/** `vertexReduceSparseKernel` over a work queue. */
+template<typename VertexValue,
+         typename AccumValue,
+         typename F>
+__global__
+void vertexReduceDenseKernel(
+    const VertexId    *workqueue,
+    const VertexId    *workqueueSize,
+    const VertexValue *vertexValues,
+    AccumValue        *partials,
+    AccumValue         init,
+    F f)
+{
+    AccumValue x = init;
+    for (VertexId pos = THREAD_INDEX; pos < *workqueueSize; pos += NUM_THREADS) {
+        f.combine(x, f.map(vertexValues[workqueue[pos]]));
+    }
+    combineBlock(x, &partials[blockIdx.x], f);
+}
+
+/**
+ * The second pass of the vertex reduction, run by a single block of
+ * `REDUCE_BLOCKS` threads: combines the partial results into `*result`.
+ */
+template<typename AccumValue,
+         typename F>
+__global__
+void combinePartialsKernel(
+    const AccumValue *partials,
+    AccumValue       *result,
+    AccumValue        init,
+    F f)
+{
+    AccumValue x = threadIdx.x < REDUCE_BLOCKS ? partials[threadIdx.x] : init;
+    combineBlock(x, result, f);
 }
 
 #endif  // OLIVER_KERNEL_H
@@ -39,6 +39,7 @@
 #include <utility>
 #include <iomanip>
 
+#include "bitmap.h"
 #include "grd.h"
 #include "flexible.h"
 #include "utils.h"
@@ -150,9 +151,10 @@ public:
     GRD<AccumValue> accumulators;
 
     /**
-     * Use a bitmap to represent the working set.
+     * Use a bitmap to represent the working set, a bit per vertex packed in
+     * words (see bitmap.h).
      */
-    GRD<int> workset;
+    GRD<Word> workset;
 
     /**
      * Use a queue to keep the work complexity low
@@ -265,7 +267,7 @@ public:
         vertexValues.reserve(vertexCount, deviceId);
         accumulators.reserve(vertexCount, deviceId);
         workqueue.reserve(vertexCount, deviceId);
-        workset.reserve(vertexCount, deviceId);
+        workset.reserve(bitmap::wordCount(vertexCount), deviceId);
         workqueueSize = static_cast<VertexId *> (malloc(sizeof(VertexId)));
         allVerticesInactive = static_cast<bool *> (malloc(sizeof(bool)));
         CUDA_CHECK(cudaMalloc(reinterpret_cast<void **> (&workqueueSizeDevice),
@@ -317,7 +319,7 @@ public:
         globalIds.cache();
         *workqueueSize = 0;
         CUDA_CHECK(H2D(workqueueSizeDevice, workqueueSize, sizeof(VertexId)));
-        workset.allTo(0);
+        workset.clear();
         double cacheTime = stopwatch.getElapsedMillis();
 
         // Initialize the message boxes accordingly.
@@ -41,22 +41,16 @@
  */
 int main(int argc, char **argv) {
 
-    CommandLine cl(argc, argv, "<inFile> -s 0");
-    char * inFile = cl.getArgument(0);
-    int source = cl.getOptionIntValue("-s", 0);
-    bool dimacs = cl.getOption("-dimacs");
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] -s 0");
+    VertexId source = cl.getOptionLongValue("-s", 0);
 
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
-    }
+    if (!graph.fromCommandLine(cl)) return 1;
 
     const int infiniteCost = 0x7fffffff;
 
     int * levels = new int[graph.vertexCount];
-    for (int i = 0; i < graph.vertexCount; i++) {
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
         levels[i] = infiniteCost;
     }
     levels[source]= 0;
@@ -82,7 +76,7 @@ int main(int argc, char **argv) {
 
     FILE * outputFile;
     outputFile = fopen("BFS.serial.txt", "w");
-    for (int i = 0; i < graph.vertexCount; i++) {
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
         fprintf(outputFile, "%d\n", levels[i]);
     }
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Checks the operations of `Bitmap` and the bulk functions of `bitmap` bit by
+ * bit against an array of flags, on random bitmaps of several sizes and
+ * densities. The biggest size spans several chunks of the thread pool.
+ */
+
+#include <random>
+
+#include "bitmap.h"
+#include "commandLine.h"
+#include "logging.h"
+
+typedef std::vector<char> Flags;
+
+/** Fills `b` and `flags` with the same bits, each set with `density`. */
+void randomBits(Bitmap &b, Flags &flags, double density, std::mt19937_64 &random) {
+    std::bernoulli_distribution bit(density);
+    b.clear();
+    flags.assign(b.capacity(), 0);
+    for (size_t i = 0; i < b.capacity(); i++) {
+        if (bit(random)) {
+            b.set(i);
+            flags[i] = 1;
+        }
+    }
+}
+
+bool sameBits(const char *what, const Bitmap &b, const Flags &flags) {
+    for (size_t i = 0; i < b.capacity(); i++) {
+        if (b.get(i) != static_cast<bool>(flags[i])) {
+            LOG(ERROR) << what << " differs at bit " << i << " of " << b.capacity();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool check(bool ok, const char *what, size_t bits) {
+    if (!ok) LOG(ERROR) << what << " is wrong for " << bits << " bits";
+    return ok;
+}
+
+/** Checks every operation on bitmaps of `bits` bits. */
+bool testSize(size_t bits, double density, std::mt19937_64 &random) {
+    Bitmap a(bits), b(bits / 2 + 1);
+    Flags fa, fb;
+    randomBits(a, fa, density, random);
+    randomBits(b, fb, density, random);
+    bool ok = sameBits("set", a, fa);
+
+    // Counting, with the default grain and with chunks of one word.
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < bits; i++) if (fa[i]) expected.push_back(i);
+    ok &= check(a.count() == expected.size(), "count", bits);
+    ok &= check(bitmap::count(a.data(), bitmap::wordCount(bits), 1) == expected.size(),
+                "bitmap::count", bits);
+
+    // Listing and iterating.
+    std::vector<size_t> list(bits + 1);
+    list.resize(a.toList(list.data()));
+    ok &= check(list == expected, "toList", bits);
+    std::vector<uint32_t> list32(bits + 1);
+    list32.resize(bitmap::toList(a.data(), bitmap::wordCount(bits), list32.data(), 1));
+    ok &= check(std::equal(list32.begin(), list32.end(), expected.begin()) &&
+                list32.size() == expected.size(), "bitmap::toList", bits);
+    std::vector<size_t> visited;
+    a.forEach([&](size_t i) { visited.push_back(i); });
+    ok &= check(visited == expected, "forEach", bits);
+    std::vector<char> seen(bits, 0);
+    a.parallelForEach([&](size_t i) { seen[i] = 1; });
+    ok &= check(seen == fa, "parallelForEach", bits);
+    size_t pos = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        pos = a.nextSetBit(pos);
+        if (pos != expected[i]) break;
+        pos++;
+    }
+    ok &= check(a.nextSetBit(pos) == bits, "nextSetBit", bits);
+
+    // In-place algebra with a smaller operand, whose missing bits are clear.
+    Flags fand(bits), f_or(bits), fxor(bits), fnot(bits);
+    for (size_t i = 0; i < bits; i++) {
+        bool x = fa[i], y = i < fb.size() && fb[i];
+        fand[i] = x && y;
+        f_or[i] = x || y;
+        fxor[i] = x != y;
+        fnot[i] = x && !y;
+    }
+    Bitmap c(a);
+    ok &= sameBits("copy", c, fa);
+    c &= b;
+    ok &= sameBits("&=", c, fand);
+    c = a;
+    c |= b;
+    ok &= sameBits("|=", c, f_or);
+    c = a;
+    c ^= b;
+    ok &= sameBits("^=", c, fxor);
+    c = a;
+    c.andNot(b);
+    ok &= sameBits("andNot", c, fnot);
+    ok &= sameBits("&", a & b, fand);
+    ok &= sameBits("|", a | b, f_or);
+    ok &= sameBits("^", a ^ b, fxor);
+
+    // Unsetting.
+    for (size_t i = 0; i < bits; i += 3) {
+        a.unset(i);
+        fa[i] = 0;
+    }
+    ok &= sameBits("unset", a, fa);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    CommandLine cl(argc, argv, "[-seed 1]");
+    std::mt19937_64 random(cl.getOptionLongValue("-seed", 1));
+
+    const size_t sizes[] = {1, 63, 64, 65, 1000, 64 * BITMAP_GRAIN * 3 + 17};
+    const double densities[] = {0.0, 0.01, 0.5, 1.0};
+    bool ok = true;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+            ok &= testSize(sizes[s], densities[d], random);
+        }
+    }
+    if (!ok) return 1;
+    LOG(INFO) << "All the bitmap operations agree with the reference.";
+    return 0;
+}
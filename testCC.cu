@@ -0,0 +1,95 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * The serial version is used to validate the correctness of the parallel
+ * version.
+ */
+
+#include <deque>
+
+#include "csrGraph.h"
+#include "commandLine.h"
+#include "timer.h"
+
+/**
+ * Breadth-first search over the edges of both directions from every vertex
+ * not labeled yet, which labels its component by the smallest id.
+ */
+int main(int argc, char **argv) {
+
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1]");
+
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+    graph.buildIncoming();
+
+    const VertexId unlabeled = static_cast<VertexId>(-1);
+
+    VertexId * labels = new VertexId[graph.vertexCount];
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
+        labels[i] = unlabeled;
+    }
+
+    double start = getTimeMillis();
+
+    VertexId components = 0;
+    std::deque<VertexId> frontier;
+    for (VertexId s = 0; s < graph.vertexCount; s++) {
+        if (labels[s] != unlabeled) continue;
+        components++;
+        labels[s] = s;
+        frontier.push_back(s);
+        while (!frontier.empty()) {
+            VertexId v = frontier.front();
+            frontier.pop_front();        // Dequeue
+            for (EdgeId e = graph.vertices[v]; e < graph.vertices[v+1]; e++) {
+                VertexId dst = graph.edges[e];
+                if (labels[dst] == unlabeled) {
+                    labels[dst] = s;
+                    frontier.push_back(dst);
+                }
+            }
+            for (EdgeId e = graph.inVertices[v]; e < graph.inVertices[v+1]; e++) {
+                VertexId src = graph.inEdges[e];
+                if (labels[src] == unlabeled) {
+                    labels[src] = s;
+                    frontier.push_back(src);
+                }
+            }
+        }
+    }
+
+    LOG(INFO) << "components=" << components << ", time="
+              << getTimeMillis() - start << "ms";
+
+    FILE * outputFile;
+    outputFile = fopen("CC.serial.txt", "w");
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
+        fprintf(outputFile, "%llu\n", (unsigned long long) labels[i]);
+    }
+    fclose(outputFile);
+    delete[] labels;
+}
@@ -16,17 +16,12 @@
 
 int main(int argc, char **argv) {
 
-    CommandLine cl(argc, argv, "<inFile> [-dimacs] [-verbose]");
-    char * inFile = cl.getArgument(0);
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-dimacs|-binary] [-verbose] [-save <snapshot>]");
     bool verbose = cl.getOption("-verbose");
-    bool dimacs = cl.getOption("-dimacs");
+    char * snapshot = cl.getOptionValue("-save");
 
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
-    }
+    if (!graph.fromCommandLine(cl)) return 1;
     
 
     // Basic Information
@@ -34,5 +29,8 @@ int main(int argc, char **argv) {
     std::cout << " Edges:" << graph.edgeCount << std::endl;
 
     if (verbose) graph.print(false);    
+
+    // Converts the input into a binary snapshot for fast loading.
+    if (snapshot && !graph.saveBinaryFile(snapshot)) return 1;
     return 0;
 }
@@ -40,18 +40,12 @@
  */
 int main(int argc, char **argv) {
 
-    CommandLine cl(argc, argv, "<inFile> [-max 100]");
-    char * inFile = cl.getArgument(0);
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-max 100]");
     int maxIterations = cl.getOptionIntValue("-max", 1000);
-    bool dimacs = cl.getOption("-dimacs");
     bool verbose = cl.getOption("-verbose");
 
     CsrGraph<int, int> graph;
-    if (dimacs) {
-        graph.fromDimacsFile(inFile);
-    } else {
-        graph.fromEdgeListFile(inFile);
-    }
+    if (!graph.fromCommandLine(cl)) return 1;
 
 
     const double damping = 0.85;
@@ -61,7 +55,7 @@ int main(int argc, char **argv) {
     double * ranks = new double[graph.vertexCount];
     double * deltas = new double[graph.vertexCount];
     double * nghSums = new double[graph.vertexCount];
-    for (int i = 0; i < graph.vertexCount; i++) {
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
         ranks[i] = oneOverN;
         deltas[i] = oneOverN;
         nghSums[i] = 0;
@@ -73,7 +67,7 @@ int main(int argc, char **argv) {
 
     int iterations = 0;
     while (iterations < maxIterations) {
-        for (int i = 0; i < graph.vertexCount; i++) {
+        for (VertexId i = 0; i < graph.vertexCount; i++) {
             nghSums[i] = 0;
         }
         for (VertexId v = 0; v < graph.vertexCount; v++) {
@@ -91,7 +85,7 @@ int main(int argc, char **argv) {
         }
 
         double err = 0.0;
-        for (int i = 0; i < graph.vertexCount; i++) {
+        for (VertexId i = 0; i < graph.vertexCount; i++) {
             err += fabs(deltas[i]);
         }
 
@@ -108,7 +102,7 @@ int main(int argc, char **argv) {
 
     FILE * outputFile;
     outputFile = fopen("PageRank.serial.txt", "w");
-    for (int i = 0; i < graph.vertexCount; i++) {
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
         fprintf(outputFile, "%f\n", ranks[i]);
     }
 
@@ -0,0 +1,85 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * The serial version is used to validate the correctness of the GPU version.
+ */
+
+#include <queue>
+#include <vector>
+#include <functional>
+
+#include "csrGraph.h"
+#include "commandLine.h"
+#include "timer.h"
+
+/**
+ * The following algorithm is Dijkstra's with a binary heap.
+ */
+int main(int argc, char **argv) {
+
+    CommandLine cl(argc, argv, "<inFile>|-gen <spec> [-seed 1] [-maxweight 1] -s 0");
+    VertexId source = cl.getOptionLongValue("-s", 0);
+
+    CsrGraph<int, int> graph;
+    if (!graph.fromCommandLine(cl)) return 1;
+
+    const int infDistance = 0x7fffffff;
+
+    int * distances = new int[graph.vertexCount];
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
+        distances[i] = infDistance;
+    }
+    distances[source] = 0;
+
+    typedef std::pair<int, VertexId> Entry;  // (distance, vertex)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+    heap.push(Entry(0, source));
+
+    double start = getTimeMillis();
+
+    while (!heap.empty()) {
+        Entry top = heap.top();
+        heap.pop();
+        VertexId v = top.second;
+        if (top.first > distances[v]) continue;  // Stale entry
+        for (EdgeId e = graph.vertices[v]; e < graph.vertices[v+1]; e++) {
+            VertexId dst = graph.edges[e];
+            int distance = distances[v] + graph.edgeValues[e];
+            if (distance < distances[dst]) {
+                distances[dst] = distance;
+                heap.push(Entry(distance, dst));
+            }
+        }
+    }
+
+    LOG(INFO) << "time=" << getTimeMillis() - start << "ms";
+
+    FILE * outputFile;
+    outputFile = fopen("SSSP.serial.txt", "w");
+    for (VertexId i = 0; i < graph.vertexCount; i++) {
+        fprintf(outputFile, "%d\n", distances[i]);
+    }
+}
@@ -0,0 +1,186 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * A fixed-size pool of host worker threads.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+/**
+ * The pool keeps `size() - 1` threads parked on a condition variable. The
+ * calling thread always takes part in a job as worker 0, so a pool of size 1
+ * runs everything inline without any synchronization.
+ *
+ * The number of workers is taken from the environment variable
+ * `OLIVE_NUM_THREADS`, or from the number of hardware threads if it is unset.
+ *
+ * @note Jobs must not be submitted from inside a running job. A nested
+ * `parallelFor` is detected and executed serially by the calling worker.
+ */
+class ThreadPool {
+public:
+    /** Returns the process-wide pool. */
+    static ThreadPool &get() {
+        static ThreadPool pool(defaultThreads());
+        return pool;
+    }
+
+    /** Number of workers, including the calling thread. */
+    inline int size() const {
+        return numWorkers;
+    }
+
+    /**
+     * Runs `job(workerId)` once on every worker and waits for all of them.
+     */
+    void run(const std::function<void(int)> &job) {
+        if (numWorkers == 1 || insideJob()) {
+            job(0);
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            currentJob = &job;
+            pending = numWorkers - 1;
+            generation++;
+        }
+        wakeup.notify_all();
+
+        insideJob() = true;
+        job(0);
+        insideJob() = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+        currentJob = NULL;
+    }
+
+    /**
+     * Splits [0, n) into chunks of `grain` items and hands them out to the
+     * workers dynamically. `f(begin, end, workerId)` is called once per chunk.
+     *
+     * If `grain` is 0, a grain is chosen so that every worker gets about
+     * eight chunks, which keeps skewed workloads balanced.
+     */
+    template<typename F>
+    void parallelFor(size_t n, F f, size_t grain = 0) {
+        if (n == 0) return;
+        if (grain == 0) {
+            grain = std::max<size_t>(n / (static_cast<size_t>(numWorkers) * 8), 1);
+        }
+        if (numWorkers == 1 || n <= grain || insideJob()) {
+            f(static_cast<size_t>(0), n, 0);
+            return;
+        }
+        std::atomic<size_t> next(0);
+        run([&](int workerId) {
+            while (true) {
+                size_t begin = next.fetch_add(grain);
+                if (begin >= n) break;
+                size_t end = std::min(begin + grain, n);
+                f(begin, end, workerId);
+            }
+        });
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+            generation++;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+private:
+    int                                numWorkers;
+    std::vector<std::thread>           threads;
+    std::mutex                         mutex;
+    std::condition_variable            wakeup;
+    std::condition_variable            finished;
+    const std::function<void(int)>    *currentJob;
+    int                                pending;
+    unsigned long                      generation;
+    bool                               stopping;
+
+    explicit ThreadPool(int n) : numWorkers(std::max(n, 1)), currentJob(NULL),
+        pending(0), generation(0), stopping(false) {
+        for (int i = 1; i < numWorkers; i++) {
+            threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator= (const ThreadPool &);
+
+    static int defaultThreads() {
+        const char *env = getenv("OLIVE_NUM_THREADS");
+        if (env != NULL && atoi(env) > 0) return atoi(env);
+        int hw = static_cast<int>(std::thread::hardware_concurrency());
+        return hw > 0 ? hw : 1;
+    }
+
+    /** Whether the current thread is executing a job of the pool. */
+    static bool &insideJob() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void workerLoop(int workerId) {
+        unsigned long seen = 0;
+        insideJob() = true;
+        while (true) {
+            const std::function<void(int)> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [&] { return generation != seen; });
+                seen = generation;
+                if (stopping) return;
+                job = currentJob;
+            }
+            (*job)(workerId);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (--pending == 0) finished.notify_one();
+            }
+        }
+    }
+};
+
+#endif  // THREAD_POOL_H
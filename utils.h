@@ -34,11 +34,15 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <string>
 #include <utility>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
 
-#include "cuda_runtime.h"
 #include "common.h"
 #include "logging.h"
+#include "threadPool.h"
 
 namespace util {
 
@@ -53,7 +57,7 @@ namespace util {
  * @param  threadsPerBlock How many threads in each block (256 by default)
  * @return                 A pair (block number, thread number per block)
  */
-std::pair<int, int> kernelConfig(int threads,
+std::pair<int, int> kernelConfig(size_t threads,
                                  int threadsPerBlock = DEFAULT_THREADS_PER_BLOCK) {
     if (threads == 0) {
         return std::make_pair(0, 0);
@@ -62,9 +66,10 @@ std::pair<int, int> kernelConfig(int threads,
     assert(threadsPerBlock <= MAX_THREADS_PER_BLOCK);
 
     if (threads < threadsPerBlock) threadsPerBlock = threads;
-    int blocks =  threads % threadsPerBlock == 0 ?
-                  threads / threadsPerBlock :
-                  threads / threadsPerBlock + 1;
+    size_t blocks = threads % threadsPerBlock == 0 ?
+                    threads / threadsPerBlock :
+                    threads / threadsPerBlock + 1;
+    // Kernels loop over the rest with a grid-wide stride.
     if (blocks > MAX_BLOCKS) blocks = MAX_BLOCKS;
     // LOG(INFO) << "The kernel is configured to (" << blocks
     //           << ", " << threadsPerBlock << ")";
@@ -72,6 +77,18 @@ std::pair<int, int> kernelConfig(int threads,
 }
 
 
+/**
+ * Blocks until all the kernels launched before have completed. Host kernels
+ * return only after all their workers are done, so it is a no-op there.
+ */
+inline void synchronize() {
+#ifndef OLIVE_HOST
+    CUDA_CHECK(cudaThreadSynchronize());
+#endif
+}
+
+#ifndef OLIVE_HOST
+
 /**
  * Enable peer access from `self` to `other`
  */
@@ -140,6 +157,8 @@ void expectOverlapOnAllDevices() {
     }
 }
 
+#endif  // OLIVE_HOST
+
 /**
  * Checks if the string is a numeric number
  * @param  str String to check
@@ -157,6 +176,203 @@ bool isNumeric(const char *str) {
     return true;
 }
 
+/**
+ * Skips spaces, tabs and carriage returns, stopping at `end` or at a newline.
+ * @return  The first position that is not a blank
+ */
+inline const char *skipBlanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/**
+ * Skips to the character following the next newline (or to `end`).
+ */
+inline const char *nextLine(const char *p, const char *end) {
+    const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+    return nl ? nl + 1 : end;
+}
+
+/**
+ * Parses an unsigned decimal integer starting at `p`, skipping leading blanks.
+ * Used by the loaders instead of sscanf to avoid per-line libc calls.
+ *
+ * @param  x  Receives the parsed value
+ * @return    The position following the number, or NULL if there is no digit
+ */
+inline const char *parseUnsigned(const char *p, const char *end,
+                                 unsigned long long &x) {
+    p = skipBlanks(p, end);
+    if (p == end || !isdigit(*p)) return NULL;
+    x = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        x = x * 10 + (*p - '0');
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Parses an optionally signed decimal number into an integral `x`.
+ * @return  The position following the number, or NULL if there is no number
+ */
+template<typename T>
+inline const char *parseValue(const char *p, const char *end, T &x,
+                              std::false_type /* isFloating */) {
+    p = skipBlanks(p, end);
+    bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+')) p++;
+    unsigned long long u;
+    if (p == end || !isdigit(*p)) return NULL;
+    p = parseUnsigned(p, end, u);
+    x = negative ? static_cast<T>(-static_cast<long long>(u)) : static_cast<T>(u);
+    return p;
+}
+
+/**
+ * Parses a decimal floating-point number (e.g. `-1.5e3`) into `x`, rounded
+ * the way `strtod` does.
+ *
+ * The digits are gathered into an integer mantissa and scaled once by a power
+ * of ten. Both are exact doubles when the mantissa is below 2^53 and the
+ * power is at most 22, so the single multiply or divide is correctly rounded.
+ * Other numbers are copied out and handed to `strtod`.
+ *
+ * @return  The position following the number, or NULL if there is no number
+ */
+template<typename T>
+inline const char *parseValue(const char *p, const char *end, T &x,
+                              std::true_type /* isFloating */) {
+    static const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    p = skipBlanks(p, end);
+    const char *start = p;
+    bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+')) p++;
+    if (p == end || !(isdigit(*p) || *p == '.')) return NULL;
+
+    // Up to 19 significant digits fit the mantissa, the rest only scale it.
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    long long exponent = 0;
+    for (; p < end && isdigit(*p); p++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isdigit(*p); p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        long long e;
+        const char *q = parseValue(p + 1, end, e, std::false_type());
+        if (q != NULL) {
+            exponent += e;
+            p = q;
+        }
+    }
+
+    double value;
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        value = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            value /= POWERS_OF_TEN[-exponent];
+        } else {
+            value *= POWERS_OF_TEN[exponent];
+        }
+    } else {
+        std::string token(start, p);
+        x = static_cast<T>(strtod(token.c_str(), NULL));
+        return p;
+    }
+    x = static_cast<T>(negative ? -value : value);
+    return p;
+}
+
+/**
+ * Parses a number of type `T` starting at `p`, skipping leading blanks.
+ * @return  The position following the number, or NULL if there is no number
+ */
+template<typename T>
+inline const char *parseValue(const char *p, const char *end, T &x) {
+    return parseValue(p, end, x, typename std::is_floating_point<T>::type());
+}
+
+/**
+ * Replaces `data[0..n)` by its exclusive prefix sum on the thread pool: every
+ * worker sums up its block, the block sums are scanned serially, and then the
+ * workers scan their blocks starting from the block offsets.
+ *
+ * @return  The sum of all the elements
+ */
+template<typename T>
+T prefixSum(T *data, size_t n) {
+    ThreadPool &pool = ThreadPool::get();
+    size_t numBlocks = std::min<size_t>(pool.size(), n / 4096 + 1);
+    std::vector<T> blockSums(numBlocks + 1, 0);
+    pool.parallelFor(numBlocks, [&](size_t begin, size_t end, int) {
+        for (size_t b = begin; b < end; b++) {
+            T sum = 0;
+            for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++) {
+                sum += data[i];
+            }
+            blockSums[b] = sum;
+        }
+    }, 1);
+    T total = 0;
+    for (size_t b = 0; b < numBlocks; b++) {
+        T sum = blockSums[b];
+        blockSums[b] = total;
+        total += sum;
+    }
+    pool.parallelFor(numBlocks, [&](size_t begin, size_t end, int) {
+        for (size_t b = begin; b < end; b++) {
+            T sum = blockSums[b];
+            for (size_t i = n * b / numBlocks; i < n * (b + 1) / numBlocks; i++) {
+                T x = data[i];
+                data[i] = sum;
+                sum += x;
+            }
+        }
+    }, 1);
+    return total;
+}
+
+/**
+ * Atomic add for the host-side graph builders, which run on the host under
+ * either backend and thus can not use the CUDA `atomicAdd`.
+ *
+ * @return  The old value
+ */
+template<typename T>
+inline T fetchAdd(T *address, T val) {
+    return __atomic_fetch_add(address, val, __ATOMIC_RELAXED);
+}
+
+/**
+ * Compare-and-swap for host-side code, like `fetchAdd`.
+ *
+ * @return  Whether `*address` held `expected` and now holds `val`
+ */
+template<typename T>
+inline bool compareAndSwap(T *address, T expected, T val) {
+    return __atomic_compare_exchange_n(address, &expected, val, false,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
 /**
  * Get the hash code of any given number very quickly
  * @param  a The number to hash
@@ -0,0 +1,199 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Yichao Cheng
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**
+ * Strategies for renumbering the vertices of a graph.
+ */
+
+#ifndef VERTEX_ORDERING_H
+#define VERTEX_ORDERING_H
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+
+/**
+ * An interface for computing a new id for every vertex, so that vertices
+ * accessed together get nearby ids and share cache lines.
+ *
+ * The ordering works on the topology only: `vertices` and `edges` are the
+ * CSR offsets and outgoing edges of a graph of `n` vertices. The result is
+ * written to `newIds`, which maps the old id of each vertex to its new one.
+ */
+class VertexOrdering {
+public:
+    virtual void getNewIds(VertexId n, const EdgeId *vertices,
+                           const VertexId *edges, VertexId *newIds) const = 0;
+
+    virtual ~VertexOrdering() {}
+
+    /**
+     * Returns the ordering of the given name ("degree", "rcm" or "community"),
+     * or NULL if there is none. The caller deletes it.
+     */
+    static VertexOrdering *fromName(const char *name);
+};
+
+/**
+ * Sorts the vertices by decreasing out-degree. The hubs, which receive most
+ * of the accesses, are packed into a few cache lines.
+ */
+class DegreeOrder: public VertexOrdering {
+public:
+    void getNewIds(VertexId n, const EdgeId *vertices, const VertexId *edges,
+                   VertexId *newIds) const {
+        std::vector<VertexId> order(n);
+        for (VertexId v = 0; v < n; v++) order[v] = v;
+        std::stable_sort(order.begin(), order.end(), [&](VertexId a, VertexId b) {
+            return vertices[a + 1] - vertices[a] > vertices[b + 1] - vertices[b];
+        });
+        for (VertexId i = 0; i < n; i++) newIds[order[i]] = i;
+    }
+};
+
+/**
+ * Reverse Cuthill-McKee. Every connected part is traversed breadth-first
+ * from a vertex of minimum degree, visiting the neighbors by increasing
+ * degree, and the resulting order is reversed. Neighbors end up close to
+ * each other, which keeps the bandwidth of the adjacency matrix small.
+ */
+class RcmOrder: public VertexOrdering {
+public:
+    void getNewIds(VertexId n, const EdgeId *vertices, const VertexId *edges,
+                   VertexId *newIds) const {
+        // Roots are tried by increasing degree.
+        std::vector<VertexId> roots(n);
+        for (VertexId v = 0; v < n; v++) roots[v] = v;
+        std::stable_sort(roots.begin(), roots.end(), [&](VertexId a, VertexId b) {
+            return degree(vertices, a) < degree(vertices, b);
+        });
+
+        std::vector<VertexId> order;
+        order.reserve(n);
+        std::vector<bool> visited(n, false);
+        std::vector<VertexId> neighbors;
+        for (VertexId r = 0; r < n; r++) {
+            if (visited[roots[r]]) continue;
+            visited[roots[r]] = true;
+            order.push_back(roots[r]);
+            for (size_t head = order.size() - 1; head < order.size(); head++) {
+                VertexId v = order[head];
+                neighbors.clear();
+                for (EdgeId e = vertices[v]; e < vertices[v + 1]; e++) {
+                    if (!visited[edges[e]]) {
+                        visited[edges[e]] = true;
+                        neighbors.push_back(edges[e]);
+                    }
+                }
+                std::stable_sort(neighbors.begin(), neighbors.end(),
+                    [&](VertexId a, VertexId b) {
+                        return degree(vertices, a) < degree(vertices, b);
+                    });
+                order.insert(order.end(), neighbors.begin(), neighbors.end());
+            }
+        }
+        for (VertexId i = 0; i < n; i++) newIds[order[n - 1 - i]] = i;
+    }
+
+private:
+    static EdgeId degree(const EdgeId *vertices, VertexId v) {
+        return vertices[v + 1] - vertices[v];
+    }
+};
+
+/**
+ * Groups the vertices by community, in the spirit of Rabbit Order. The
+ * communities are found by label propagation: every vertex repeatedly
+ * takes the most frequent label among itself and its out-neighbors (the
+ * smallest one on ties). Communities are then laid out one after another,
+ * in the order of their first vertex, and each keeps the relative order
+ * of its members.
+ */
+class CommunityOrder: public VertexOrdering {
+public:
+    explicit CommunityOrder(int _rounds = 5) : rounds(_rounds) {}
+
+    void getNewIds(VertexId n, const EdgeId *vertices, const VertexId *edges,
+                   VertexId *newIds) const {
+        std::vector<VertexId> labels(n);
+        for (VertexId v = 0; v < n; v++) labels[v] = v;
+
+        // Labels are updated in place, so a label can travel far in a round.
+        std::vector<VertexId> candidates;
+        for (int round = 0; round < rounds; round++) {
+            bool changed = false;
+            for (VertexId v = 0; v < n; v++) {
+                candidates.clear();
+                candidates.push_back(labels[v]);
+                for (EdgeId e = vertices[v]; e < vertices[v + 1]; e++) {
+                    candidates.push_back(labels[edges[e]]);
+                }
+                std::sort(candidates.begin(), candidates.end());
+                VertexId best = candidates[0];
+                size_t bestCount = 0;
+                for (size_t i = 0; i < candidates.size(); ) {
+                    size_t j = i;
+                    while (j < candidates.size() && candidates[j] == candidates[i]) j++;
+                    if (j - i > bestCount) {
+                        best = candidates[i];
+                        bestCount = j - i;
+                    }
+                    i = j;
+                }
+                if (best != labels[v]) {
+                    labels[v] = best;
+                    changed = true;
+                }
+            }
+            if (!changed) break;
+        }
+
+        // Counting sort by community, with the communities numbered by their
+        // first vertex.
+        std::vector<VertexId> rank(n, n);
+        VertexId communities = 0;
+        for (VertexId v = 0; v < n; v++) {
+            if (rank[labels[v]] == n) rank[labels[v]] = communities++;
+        }
+        std::vector<VertexId> offsets(communities + 1, 0);
+        for (VertexId v = 0; v < n; v++) offsets[rank[labels[v]] + 1]++;
+        for (VertexId c = 0; c < communities; c++) offsets[c + 1] += offsets[c];
+        for (VertexId v = 0; v < n; v++) newIds[v] = offsets[rank[labels[v]]]++;
+    }
+
+private:
+    int rounds;
+};
+
+inline VertexOrdering *VertexOrdering::fromName(const char *name) {
+    if (strcmp(name, "degree") == 0) return new DegreeOrder();
+    if (strcmp(name, "rcm") == 0) return new RcmOrder();
+    if (strcmp(name, "community") == 0) return new CommunityOrder();
+    return NULL;
+}
+
+#endif  // VERTEX_ORDERING_H
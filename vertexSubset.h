@@ -39,30 +39,39 @@ class VertexSubset {
 public:
     /**
      * VertexSubset has two representations, which can convert to each other.
-     * The sparse representation uses a bitmap to represent the working set.
-     * The dense one uses a queue.
+     * The sparse representation uses a bit per vertex to represent the
+     * working set, in 64-bit words (see bitmap.h), which are cleared, counted
+     * and scanned a whole at a time. The dense one uses a queue of the
+     * vertex ids.
+     *
+     * Only the buffers of the current representation are valid. The other
+     * ones are allocated on the first conversion and then reused.
      */
-    GRD<int>        workset;
+    GRD<Word>       workset;
     GRD<VertexId>   workqueue;
     VertexId       *qSize;
     VertexId       *qSizeDevice;
     bool            isDense;
 
     /** Make empty subset */
-    VertexSubset() : qSize(NULL), qSizeDevice(NULL), isDense(false) {}
+    VertexSubset() : qSize(NULL), qSizeDevice(NULL), isDense(false),
+        maxSize(0) {}
 
     /**
      * Make a sparse vertex subset of n vertices.
      * @param n          The size of the set
      * @param universal  Indicating the set is empty or universal
      */
-    VertexSubset(VertexId n, bool universal) {
+    VertexSubset(VertexId n, bool universal) : qSize(NULL), qSizeDevice(NULL),
+        maxSize(n) {
         isDense = false;
-        workset.reserve(n);
+        workset.reserve(bitmap::wordCount(n));
         if (universal) {
-            workset.allTo(1);
+            // The bits past `n` stay clear.
+            workset.allTo(~static_cast<Word>(0));
+            workset.set(workset.capacity() - 1, bitmap::tailMask(n));
         } else {
-            workset.allTo(0);
+            workset.clear();
         }
     }
 
@@ -70,13 +79,10 @@ public:
      * Make a dense vertex subset of no vertex inside.
      * @param n  The size of the set
      */
-    VertexSubset(VertexId n) {
+    VertexSubset(VertexId n) : maxSize(n) {
         isDense = true;
         workqueue.reserve(n);
-        qSize = (VertexId *) malloc(sizeof(VertexId));
-        *qSize = 0;
-        CUDA_CHECK(cudaMalloc((void **) &qSizeDevice, sizeof(VertexId)));
-        CUDA_CHECK(H2D(qSizeDevice, qSize, sizeof(VertexId)));
+        allocQueueSize(0);
     }
 
     /** 
@@ -84,56 +90,137 @@ public:
      * @param n  The size of the set
      * @param v  The singleton vertex
      */
-    VertexSubset(VertexId n, VertexId v) {
+    VertexSubset(VertexId n, VertexId v) : maxSize(n) {
         isDense = true;
         workqueue.reserve(n);
         workqueue.set(0, v);  // push v
-        qSize = (VertexId *) malloc(sizeof(VertexId));
-        *qSize = 1;
-        CUDA_CHECK(cudaMalloc((void **) &qSizeDevice, sizeof(VertexId)));
-        CUDA_CHECK(H2D(qSizeDevice, qSize, sizeof(VertexId)));
+        allocQueueSize(1);
     }
 
     /**
-     * Transfer all the `workqueueSize` back and sum them up.
+     * Returns the number of vertices in the subset. A sparse subset counts
+     * its bits, which takes a pass over all of its words.
      */
     inline VertexId size() const {
         if (isDense) {
+#ifndef OLIVE_HOST
             CUDA_CHECK(D2H(qSize, qSizeDevice, sizeof(VertexId)));
+#endif
             return *qSize;
-        } else {
-            assert(0);
         }
+        if (flagCount.capacity() == 0) flagCount.reserve(1);
+        flagCount.set(0, 0);
+        auto c = util::kernelConfig(workset.capacity());
+        countFlagsKernel KERNEL_CONFIG(c)(
+            workset.elemsDevice,
+            maxSize,
+            flagCount.elemsDevice);
+        util::synchronize();
+        flagCount.persist();
+        return flagCount[0];
     }
 
     inline VertexId capacity() const {
-        return isDense ? workqueue.capacity() : workset.capacity(); 
+        return maxSize;
     }
 
     inline void clear() {
         if (isDense) {
             *qSize = 0;
+#ifndef OLIVE_HOST
             CUDA_CHECK(H2D(qSizeDevice, qSize, sizeof(VertexId)));
+#endif
         } else {
             workset.clear();
         }
     }
 
+    /** Empties the subset and makes it dense. */
+    inline void clearAsQueue() {
+        if (workqueue.capacity() == 0) workqueue.reserve(maxSize);
+        if (qSize == NULL) allocQueueSize(0);
+        isDense = true;
+        clear();
+    }
+
+    /** Empties the subset and makes it sparse. */
+    inline void clearAsFlags() {
+        if (workset.capacity() == 0) workset.reserve(bitmap::wordCount(maxSize));
+        isDense = false;
+        clear();
+    }
+
+    /**
+     * Converts the subset to the dense representation, by compacting the
+     * flags into the queue. The order of the queue is unspecified.
+     */
+    void toQueue() {
+        if (isDense) return;
+        if (workqueue.capacity() == 0) workqueue.reserve(maxSize);
+        if (qSize == NULL) allocQueueSize(0);
+        isDense = true;
+        clear();
+        auto c = util::kernelConfig(workset.capacity());
+        flagsToQueueKernel KERNEL_CONFIG(c)(
+            workset.elemsDevice,
+            maxSize,
+            workqueue.elemsDevice,
+            qSizeDevice);
+        util::synchronize();
+    }
+
+    /** Converts the subset to the sparse representation. */
+    void toFlags() {
+        if (!isDense) return;
+        if (workset.capacity() == 0) workset.reserve(bitmap::wordCount(maxSize));
+        workset.clear();
+        auto c = util::kernelConfig(size());
+        queueToFlagsKernel KERNEL_CONFIG(c)(
+            workqueue.elemsDevice,
+            qSizeDevice,
+            workset.elemsDevice);
+        util::synchronize();
+        isDense = false;
+    }
+
+    /**
+     * Appends the vertices of the queue `other` to this queue. Vertices in
+     * both are kept twice, so the caller keeps them apart.
+     */
+    void append(const VertexSubset &other) {
+        assert(isDense && other.isDense);
+        VertexId n = size();
+        VertexId m = other.size();
+        assert(n + m <= maxSize);
+        if (m == 0) return;
+#ifdef OLIVE_HOST
+        std::copy(other.workqueue.elemsHost, other.workqueue.elemsHost + m,
+                  workqueue.elemsHost + n);
+#else
+        CUDA_CHECK(cudaMemcpy(workqueue.elemsDevice + n, other.workqueue.elemsDevice,
+                              m * sizeof(VertexId), cudaMemcpyDefault));
+#endif
+        *qSize = n + m;
+#ifndef OLIVE_HOST
+        CUDA_CHECK(H2D(qSizeDevice, qSize, sizeof(VertexId)));
+#endif
+    }
+
     inline void print() {
         if (isDense) {
-            CUDA_CHECK(D2H(qSize, qSizeDevice, sizeof(VertexId)));
+            size();
             workqueue.persist();
             printf("dense: ");
-            for (int i = 0; i < *qSize; i++) {
-                printf("%d ", workqueue[i]);
+            for (VertexId i = 0; i < *qSize; i++) {
+                printf("%llu ", (unsigned long long) workqueue[i]);
             }
             printf("\n");
         } else {
             workset.persist();
             printf("sparse: ");
-            for (int i = 0; i < workset.capacity(); i++) {
-                if (workset[i] == 1) {
-                    printf("%d ", i);
+            for (VertexId i = 0; i < maxSize; i++) {
+                if (bitmap::get(workset.elemsHost, i)) {
+                    printf("%llu ", (unsigned long long) i);
                 }
             }
             printf("\n");
@@ -141,15 +228,37 @@ public:
     }
 
     void del() {
-        if (isDense) {
-            workqueue.del();
-            if (qSize) free(qSize);
-            if (qSizeDevice) cudaFree(qSizeDevice);
-        } else {
-            workset.del();
-        }
+        workqueue.del();
+        workset.del();
+        flagCount.del();
+        if (qSize) free(qSize);
+#ifndef OLIVE_HOST
+        if (qSizeDevice) cudaFree(qSizeDevice);
+#endif
+    }
+
+private:
+    /**
+     * Allocates the queue size counter on both sides. The host backend shares
+     * a single counter.
+     */
+    void allocQueueSize(VertexId initial) {
+        qSize = (VertexId *) malloc(sizeof(VertexId));
+        *qSize = initial;
+#ifdef OLIVE_HOST
+        qSizeDevice = qSize;
+#else
+        CUDA_CHECK(cudaMalloc((void **) &qSizeDevice, sizeof(VertexId)));
+        CUDA_CHECK(H2D(qSizeDevice, qSize, sizeof(VertexId)));
+#endif
     }
 
+    /** The number of vertices the subset is drawn from. */
+    VertexId        maxSize;
+
+    /** Where `size()` counts the flags. Allocated on demand. */
+    mutable GRD<VertexId> flagCount;
+
     // ~VertexSubset() {
     //     del();
     // }